@@ -12,6 +12,11 @@
 Adafruit_ADS1115 ads;
 extern OneWire oneWire;              // Setup a oneWire instance to communicate with any OneWire devices
 extern DallasTemperature tempSensor; // Pass our oneWire reference to Dallas Temperature sensor
+extern ESP_Profiler profiler;
+
+// ADS1115 gains from narrowest to widest, with their full scale in mV
+static const adsGain_t gains[] = {GAIN_SIXTEEN, GAIN_EIGHT, GAIN_FOUR, GAIN_TWO, GAIN_ONE};
+static const float gainFullScale[] = {256, 512, 1024, 2048, 4096};
 
 ESP_EC::ESP_EC()
 {
@@ -19,6 +24,8 @@ ESP_EC::ESP_EC()
 
     ads.setGain(GAIN_ONE);
     ads.begin();
+    _countScale = 1;
+    _countScaleQ12 = 4096;
 
     _eepromStartAddress = 10; // the start address of the EC calb. param. stored in the EEPROM
 
@@ -31,6 +38,14 @@ ESP_EC::ESP_EC()
     _sensorName = "EC";
     _calibParamCount = 2;
     _sensorUnit = "mS/cm";
+    _rawReadStage = STAGE_ADS_READ;
+    _rawFullScale = 32767;
+    _deadband = EC_DEADBAND;
+
+    _derivedName = "TSS_EC";
+    _derivedUnit = "mg/L";
+    _derivedSlope = EC_TSS_SLOPE;
+    _derivedIntercept = EC_TSS_INTERCEPT;
 }
 
 ESP_EC::~ESP_EC()
@@ -40,15 +55,15 @@ ESP_EC::~ESP_EC()
 // compensate raw EC with calibration value and temperature
 float ESP_EC::calculateValueFromVolt()
 {
-    float kValueLow = RES2 * ECREF * EC_LOW_VALUE / 1000.0 / _lowCondVolt;
-    float kValueHigh = RES2 * ECREF * EC_HIGH_VALUE / 1000.0 / _highCondVolt;
+    float kValueLow = RES2 * ECREF * EC_LOW_VALUE / 1000.0f / _lowCondVolt;
+    float kValueHigh = RES2 * ECREF * EC_HIGH_VALUE / 1000.0f / _highCondVolt;
     float value, valueTemp;
     float _rawEC = 1000 * _voltage / RES2 / ECREF;
     valueTemp = _rawEC * kValueLow; // use default K value (kvalueLow)
     // automatic shift process
     // First Range:(0,2.5); Second Range:(2.5,20)
     // if > 2.5, kvalue high, else low (stays default)
-    if (valueTemp > 2.5)
+    if (valueTemp > 2.5f)
     {
         value = _rawEC * kValueHigh;
     }
@@ -62,21 +77,94 @@ float ESP_EC::calculateValueFromVolt()
 float ESP_EC::compensateVoltWithTemperature()
 {
     float voltage;
-    tempSensor.requestTemperatures();
-    _temperature = tempSensor.getTempCByIndex(0);                // store last temperature value
-    voltage = _voltage / (1.0 + 0.0185 * (_temperature - 25.0)); // temperature compensation
+    voltage = _voltage / (1.0f + 0.0185f * (_temperature - 25.0f)); // temperature compensation
     return voltage;
 }
 
-void ESP_EC::readAndAverageVolt()
+bool ESP_EC::usesTemperature()
 {
-    float adsvoltage;
-    float voltage = 0;
-    int n = 100;
-    for (int i = 0; i < n; i++)
+    return true;
+}
+
+// one single-shot conversion on AIN0 as readADC_SingleEnded() does it,
+// but with the I2C results checked: the library returns a failed read as
+// 0xFFFF, the same code as a conversion of -1 count. Counts below zero
+// (offset around 0 V) are clamped to 0.
+int ESP_EC::readRawSample()
+{
+    uint16_t config = ADS1015_REG_CONFIG_CQUE_NONE | ADS1015_REG_CONFIG_CLAT_NONLAT |
+                      ADS1015_REG_CONFIG_CPOL_ACTVLOW | ADS1015_REG_CONFIG_CMODE_TRAD |
+                      ADS1015_REG_CONFIG_DR_1600SPS | ADS1015_REG_CONFIG_MODE_SINGLE | ads.getGain() |
+                      ADS1015_REG_CONFIG_MUX_SINGLE_0 | ADS1015_REG_CONFIG_OS_SINGLE;
+    Wire.beginTransmission(ADS1015_ADDRESS);
+    Wire.write(ADS1015_REG_POINTER_CONFIG);
+    Wire.write(config >> 8);
+    Wire.write(config & 0xFF);
+    bool isReadOk = (Wire.endTransmission() == 0);
+    if (isReadOk)
+    {
+        delay(ADS1115_CONVERSIONDELAY);
+        Wire.beginTransmission(ADS1015_ADDRESS);
+        Wire.write(ADS1015_REG_POINTER_CONVERT);
+        isReadOk = (Wire.endTransmission() == 0) && (Wire.requestFrom((uint8_t)ADS1015_ADDRESS, (uint8_t)2) == 2);
+    }
+    if (!isReadOk)
     {
-        adsvoltage = ads.readADC_SingleEnded(0) / 10;
-        voltage += 0.0000022091 * pow(adsvoltage, 3.0) - 0.00243269 * pow(adsvoltage, 2.0) + 1.74097 * adsvoltage - 8.11739;
+        profiler.count(COUNTER_I2C_ERROR);
+        return RAW_READ_ERROR;
     }
-    _voltage = voltage / n;
-}
\ No newline at end of file
+    uint16_t high = Wire.read();
+    uint16_t low = Wire.read();
+    int16_t raw = (high << 8) | low;
+    return (raw < 0) ? 0 : raw;
+}
+
+// the correction polynomial takes GAIN_ONE counts / 10, less the mean of
+// the original truncation so calibrations made with it stay valid
+float ESP_EC::convertRawToVolt(int raw)
+{
+    float adsvoltage = raw * _countScale / 10.0f - ADS_TRUNCATION_OFFSET;
+    // 0.0000022091 x^3 - 0.00243269 x^2 + 1.74097 x - 8.11739, Horner form
+    return ((0.0000022091f * adsvoltage - 0.00243269f) * adsvoltage + 1.74097f) * adsvoltage - 8.11739f;
+}
+
+// same polynomial in 64-bit integer math: input in Q12, Horner in Q40, result
+// in Q16.16, which saturates above 32767 mV (inputs above ~3.4 V at GAIN_ONE)
+int32_t ESP_EC::convertRawToVoltQ16(int raw)
+{
+    int64_t adsvoltage = (int64_t)constrain(raw, 0, _rawFullScale) * _countScaleQ12 / 10 - ADS_TRUNCATION_OFFSET_Q12;
+    int64_t voltage = (ADS_POLY_C3_Q40 * adsvoltage >> 12) + ADS_POLY_C2_Q40;
+    voltage = (voltage * adsvoltage >> 12) + ADS_POLY_C1_Q40;
+    voltage = (voltage >> 12) * adsvoltage + ADS_POLY_C0_Q40;
+    return constrain(voltage >> 24, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+}
+
+void ESP_EC::resetRange()
+{
+    ads.setGain(GAIN_ONE);
+    _countScale = 1;
+    _countScaleQ12 = 4096;
+    _burstSampleCount = BURST_SAMPLE_COUNT;
+    _isRangeNarrowed = false;
+}
+
+void ESP_EC::selectRange()
+{
+    if (!AUTO_RANGING)
+    {
+        return;
+    }
+    float peak = _coarseMaxRaw * 0.125f * (1.0f + AUTORANGE_HEADROOM); // 0.125 mV per count at GAIN_ONE
+    for (int i = 0; i < 4; i++) // the widest one is already set
+    {
+        if (peak < gainFullScale[i])
+        {
+            ads.setGain(gains[i]);
+            _countScale = gainFullScale[i] / 4096.0f;
+            _countScaleQ12 = _countScale * 4096;
+            _burstSampleCount = RANGED_BURST_SAMPLE_COUNT;
+            _isRangeNarrowed = true;
+            return;
+        }
+    }
+}
@@ -13,10 +13,25 @@
 #include "Adafruit_ADS1015.h"
 #include "ESP_Sensor.h"
 
-#define EC_LOW_VALUE 1.413
-#define EC_HIGH_VALUE 12.88
-#define RES2 900.0
-#define ECREF 200.0
+#define EC_LOW_VALUE 1.413f
+#define EC_HIGH_VALUE 12.88f
+#define RES2 900.0f
+#define ECREF 200.0f
+#define EC_TSS_SLOPE 640.0f // mg/L TSS per mS/cm, site correlation
+#define EC_TSS_INTERCEPT 0.0f
+#define EC_DEADBAND 0.05f // mS/cm
+
+// the original code fed readADC_SingleEnded() / 10 in integer math to the
+// board correction; on average that dropped 0.45 of a GAIN_ONE count / 10,
+// which the fielded EC calibrations include, so the finer input keeps it
+#define ADS_TRUNCATION_OFFSET 0.45f   // GAIN_ONE counts / 10
+#define ADS_TRUNCATION_OFFSET_Q12 1843 // the same in Q12
+
+// ADS1115 board correction polynomial coefficients in Q40, for the fixed-point path
+#define ADS_POLY_C3_Q40 2428931LL        // 0.0000022091
+#define ADS_POLY_C2_Q40 -2674770942LL    // -0.00243269
+#define ADS_POLY_C1_Q40 1914216758609LL  // 1.74097
+#define ADS_POLY_C0_Q40 -8925164692193LL // -8.11739
 
 class ESP_EC : public ESP_Sensor
 {
@@ -27,11 +42,18 @@ public:
 private:
     float _lowCondVolt;
     float _highCondVolt;
+    float _countScale;   // GAIN_ONE counts per count at the selected gain
+    int32_t _countScaleQ12;
 
     float calculateValueFromVolt();
     float compensateVoltWithTemperature();
+    bool usesTemperature();
     void captureCalibVolt(bool *calibrationFinish);
-    void readAndAverageVolt();
+    int readRawSample();
+    float convertRawToVolt(int raw);
+    int32_t convertRawToVoltQ16(int raw);
+    void resetRange();
+    void selectRange();
 };
 
 #endif
@@ -0,0 +1,202 @@
+#include "ESP_Link.h"
+
+// fastest first, the sink picks one that it and the XBee also support
+static const unsigned long supportedBaudRates[] = {115200U, 57600U, 38400U, 19200U, BASE_BAUD_RATE};
+
+ESP_Link::ESP_Link(HardwareSerial *serial)
+{
+    _serial = serial;
+    _baudRate = BASE_BAUD_RATE;
+    _uartErrorCount = 0;
+    _seenUartErrorCount = 0;
+    _lineStartUartErrorCount = 0;
+    _consecutiveErrorCount = 0;
+    _lastReceiveTime = 0;
+}
+
+void ESP_Link::begin()
+{
+    _serial->begin(BASE_BAUD_RATE);
+    _serial->onReceiveError([this](hardwareSerial_error_t error) {
+        if ((error == UART_FRAME_ERROR) || (error == UART_PARITY_ERROR) || (error == UART_BREAK_ERROR))
+        {
+            _uartErrorCount++;
+        }
+    });
+}
+
+// "baud" lists the supported rates as Baud#<rate>,<rate>,...
+// "baud:<rate>" switches to <rate> after replying "baudok", then the sink
+// must send "baudcheck" at the new rate within LINK_VERIFY_TIMEOUT,
+// answered by "baudconfirmed"; otherwise the node goes back to
+// BASE_BAUD_RATE. True when a new rate was confirmed.
+bool ESP_Link::negotiate(String inString)
+{
+    if (inString == "baud")
+    {
+        _serial->print(F("Baud#"));
+        for (unsigned int i = 0; i < sizeof(supportedBaudRates) / sizeof(supportedBaudRates[0]); i++)
+        {
+            if (i > 0)
+            {
+                _serial->print(F(","));
+            }
+            _serial->print(supportedBaudRates[i]);
+        }
+        _serial->println();
+        return false;
+    }
+    unsigned long baudRate = inString.substring(5).toInt();
+    bool isSupported = false;
+    for (unsigned int i = 0; i < sizeof(supportedBaudRates) / sizeof(supportedBaudRates[0]); i++)
+    {
+        if (supportedBaudRates[i] == baudRate)
+        {
+            isSupported = true;
+        }
+    }
+    if (!inString.startsWith("baud:") || !isSupported)
+    {
+        _serial->println(F("baudno"));
+        return false;
+    }
+    _serial->print(F("baudok:"));
+    _serial->println(baudRate);
+    setBaudRate(baudRate);
+
+    unsigned long timepoint = millis();
+    String line;
+    while (millis() - timepoint < LINK_VERIFY_TIMEOUT)
+    {
+        if (pollLine(&line) && (line == "baudcheck"))
+        {
+            _serial->println(F("baudconfirmed"));
+            return true;
+        }
+    }
+    setBaudRate(BASE_BAUD_RATE); // sink never heard us, try again at the base rate
+    return false;
+}
+
+void ESP_Link::setBaudRate(unsigned long baudRate)
+{
+    _serial->flush(); // let the last reply leave at the old rate
+    _serial->updateBaudRate(baudRate);
+    while (_serial->available()) // drop bytes received during the switch
+    {
+        _serial->read();
+    }
+    _baudRate = baudRate;
+    _line = "";
+    _seenUartErrorCount = _uartErrorCount;
+    _lineStartUartErrorCount = _seenUartErrorCount;
+    _consecutiveErrorCount = 0;
+}
+
+// non-blocking: takes what was received so far, true with the trimmed
+// line once its '\n' arrived; falls back to BASE_BAUD_RATE when the
+// receive errors since the last good line reach LINK_ERROR_LIMIT
+bool ESP_Link::pollLine(String *line)
+{
+    if (_uartErrorCount != _seenUartErrorCount)
+    {
+        _seenUartErrorCount = _uartErrorCount;
+        _lastReceiveTime = millis();
+    }
+    bool isLineComplete = false;
+    while (!isLineComplete && _serial->available())
+    {
+        char c = _serial->read();
+        _lastReceiveTime = millis();
+        if (c == '\n')
+        {
+            *line = _line;
+            line->trim();
+            endLine(*line);
+            isLineComplete = true;
+        }
+        else
+        {
+            _line += c;
+        }
+    }
+    // a transmission at another rate rarely ends with a readable '\n',
+    // so a pause after a receive error also ends the line
+    if (!isLineComplete && ((_uartErrorCount != _lineStartUartErrorCount) || isGarbled(_line)) &&
+        (millis() - _lastReceiveTime > LINK_LINE_GAP))
+    {
+        String partialLine = _line;
+        endLine(partialLine);
+    }
+    if ((_consecutiveErrorCount >= LINK_ERROR_LIMIT) && (_baudRate != BASE_BAUD_RATE))
+    {
+        _serial->println(F("baudreset")); // at the rate the sink is still listening at
+        setBaudRate(BASE_BAUD_RATE);
+        _serial->println(F("baudreset")); // and at the rate it falls back to
+        return false;
+    }
+    return isLineComplete;
+}
+
+// a line with a receive error or a non-printable character adds to the
+// consecutive errors, a good one clears them
+void ESP_Link::endLine(const String &line)
+{
+    uint32_t uartErrorCount = _uartErrorCount;
+    bool isError = (uartErrorCount != _lineStartUartErrorCount) || isGarbled(line);
+    if (isError && (_consecutiveErrorCount < LINK_ERROR_LIMIT))
+    {
+        _consecutiveErrorCount++;
+    }
+    else if (!isError && (line.length() > 0))
+    {
+        _consecutiveErrorCount = 0;
+    }
+    _lineStartUartErrorCount = uartErrorCount;
+    _line = "";
+}
+
+bool ESP_Link::isGarbled(const String &line)
+{
+    for (unsigned int i = 0; i < line.length(); i++)
+    {
+        if (((byte)line[i] < 0x20) || ((byte)line[i] > 0x7E))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// a command line, or what arrived of it within LINK_READ_TIMEOUT
+String ESP_Link::readCommand()
+{
+    String line;
+    unsigned long timepoint = millis();
+    while (millis() - timepoint < LINK_READ_TIMEOUT)
+    {
+        if (pollLine(&line))
+        {
+            return line;
+        }
+    }
+    line = _line;
+    line.trim();
+    _line = "";
+    return line;
+}
+
+// drains the input while no command is expected, so receive errors
+// still count towards the fallback
+void ESP_Link::checkErrors()
+{
+    String line;
+    while (pollLine(&line))
+    {
+    }
+}
+
+unsigned long ESP_Link::baudRate()
+{
+    return _baudRate;
+}
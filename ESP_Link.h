@@ -0,0 +1,49 @@
+#ifndef _ESP_LINK_H_
+#define _ESP_LINK_H_
+
+#include <Arduino.h>
+
+// PI COMMAND -> LINK
+#define BASE_BAUD_RATE 9600U      // every wake starts here, see negotiate()
+#define LINK_VERIFY_TIMEOUT 2000U // ms for the sink to confirm a new baud rate
+#define LINK_READ_TIMEOUT 3000U   // ms, readCommand() gives up after this
+#define LINK_LINE_GAP 50U         // ms of silence that ends a line with a receive error
+#define LINK_ERROR_LIMIT 3        // consecutive lines with receive errors before falling back to BASE_BAUD_RATE
+//
+
+// Serial link to the Sink Node with baud rate negotiation. A received
+// line is an error when the UART raised an error event (framing, parity,
+// break, as when the two ends run at different rates) while it arrived,
+// or when it holds non-printable characters. Such lines are counted
+// until a good line arrives; after LINK_ERROR_LIMIT of them at a
+// negotiated rate the node sends "baudreset" at that rate, then again at
+// BASE_BAUD_RATE, and stays at BASE_BAUD_RATE. All input goes through
+// pollLine(), so errors are also seen while a report or a stream is
+// being sent.
+class ESP_Link
+{
+public:
+    ESP_Link(HardwareSerial *serial);
+    void begin();
+    bool negotiate(String inString);
+    bool pollLine(String *line);
+    String readCommand();
+    void checkErrors();
+    unsigned long baudRate();
+
+private:
+    HardwareSerial *_serial;
+    unsigned long _baudRate;
+    volatile uint32_t _uartErrorCount; // raised by the UART event task
+    uint32_t _seenUartErrorCount;
+    uint32_t _lineStartUartErrorCount;
+    byte _consecutiveErrorCount;
+    unsigned long _lastReceiveTime;
+    String _line;
+
+    void setBaudRate(unsigned long baudRate);
+    void endLine(const String &line);
+    static bool isGarbled(const String &line);
+};
+
+#endif
@@ -9,8 +9,8 @@ ESP_NH3N::ESP_NH3N()
 
     // default values
     _eepromStartAddress = 34;
-    _strongBaseVolt = 2600.0;
-    _weakBaseVolt = 2400.0;
+    _strongBaseVolt = 2600.0f;
+    _weakBaseVolt = 2400.0f;
 
     _calibParamArray[0] = {WEAK_BASE_VALUE, &_weakBaseVolt};
     _calibParamArray[1] = {STRONG_BASE_VALUE, &_strongBaseVolt};
@@ -19,6 +19,7 @@ ESP_NH3N::ESP_NH3N()
     _calibParamCount = 2;
     _sensorUnit = "mg/L";
     _sensorPin = 35;
+    _deadband = NH3N_DEADBAND;
 }
 
 ESP_NH3N::~ESP_NH3N()
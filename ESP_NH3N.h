@@ -4,8 +4,9 @@
 #include "ESP_Sensor.h"
 
 
-#define STRONG_BASE_VALUE 131.58 // NH3-N concentration in mg/L
-#define WEAK_BASE_VALUE 36.956
+#define STRONG_BASE_VALUE 131.58f // NH3-N concentration in mg/L
+#define WEAK_BASE_VALUE 36.956f
+#define NH3N_DEADBAND 1.0f // mg/L
 
 class ESP_NH3N : public ESP_Sensor
 {
@@ -17,8 +17,8 @@ ESP_PH::ESP_PH()
     _resetCalibratedValueToDefault = 0;
 
     _eepromStartAddress = 0; // the start address of the pH calibration parameters stored in the EEPROM
-    _acidVolt = 1215.0;    // buffer solution 4.01 at 25C
-    _neutralVolt = 1600.0; // buffer solution 6.86 at 25C
+    _acidVolt = 1215.0f;   // buffer solution 4.01 at 25C
+    _neutralVolt = 1600.0f; // buffer solution 6.86 at 25C
 
     _calibParamArray[0] = {NEUTRAL_VALUE, &_neutralVolt};
     _calibParamArray[1] = {ACID_VALUE, &_acidVolt};
@@ -27,6 +27,7 @@ ESP_PH::ESP_PH()
     _calibParamCount = 2;
     _sensorUnit = "";
     _sensorPin = 35;
+    _deadband = PH_DEADBAND;
 }
 
 ESP_PH::~ESP_PH()
@@ -44,8 +45,11 @@ float ESP_PH::calculateValueFromVolt()
 float ESP_PH::compensateVoltWithTemperature()
 {
     float voltage;
-    tempSensor.requestTemperatures();
-    _temperature = tempSensor.getTempCByIndex(0);
-    voltage = 1500 + (_voltage - 1500) * (298.15 / (_temperature + 273.15));
+    voltage = 1500 + (_voltage - 1500) * (298.15f / (_temperature + 273.15f));
     return voltage;
 }
+
+bool ESP_PH::usesTemperature()
+{
+    return true;
+}
@@ -12,8 +12,9 @@
 
 #include "ESP_Sensor.h"
 
-#define NEUTRAL_VALUE 6.86
-#define ACID_VALUE 4.01
+#define NEUTRAL_VALUE 6.86f
+#define ACID_VALUE 4.01f
+#define PH_DEADBAND 0.05f
 
 class ESP_PH : public ESP_Sensor
 {
@@ -27,6 +28,7 @@ private:
 
     float calculateValueFromVolt();
     float compensateVoltWithTemperature();
+    bool usesTemperature();
 };
 
 #endif
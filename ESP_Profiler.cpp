@@ -0,0 +1,92 @@
+#include "ESP_Profiler.h"
+#include "ESP_Trace.h"
+
+extern ESP_Trace trace;
+
+static const char *stageNames[STAGE_COUNT] = {"Measure", "Burst", "ADC", "ADS", "Temp", "Display", "Report"};
+static const char *counterNames[COUNTER_COUNT] = {"I2CError", "OneWireError"};
+
+void ESP_Profiler::reset()
+{
+    memset(_histogram, 0, sizeof(_histogram));
+    memset(_totalCycles, 0, sizeof(_totalCycles));
+    memset(_maxCycles, 0, sizeof(_maxCycles));
+    memset(_counters, 0, sizeof(_counters));
+}
+
+uint32_t ESP_Profiler::start()
+{
+    return ESP.getCycleCount();
+}
+
+void ESP_Profiler::stop(byte stage, uint32_t startCycles)
+{
+    if (trace.isReplaying()) // a replayed cycle does not time the hardware
+    {
+        return;
+    }
+    uint32_t cycles = ESP.getCycleCount() - startCycles; // wraps after ~17 s at 240 MHz
+    byte bucket = (cycles == 0) ? 0 : 31 - __builtin_clz(cycles);
+    _histogram[stage][bucket]++;
+    _totalCycles[stage] += cycles;
+    if (cycles > _maxCycles[stage])
+    {
+        _maxCycles[stage] = cycles;
+    }
+}
+
+void ESP_Profiler::count(byte counter)
+{
+    if (trace.isReplaying())
+    {
+        return;
+    }
+    _counters[counter]++;
+}
+
+// format: Stats#CpuMHz:<mhz>;<stage>:<count>,<mean us>,<max us>,<bucket>:<count> ...;<counter>:<count>;
+void ESP_Profiler::report(Stream *out)
+{
+    uint32_t cpuMHz = ESP.getCpuFreqMHz();
+    out->print(F("Stats#CpuMHz:"));
+    out->print(cpuMHz);
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        uint32_t count = 0;
+        for (int bucket = 0; bucket < PROFILE_BUCKET_COUNT; bucket++)
+        {
+            count += _histogram[stage][bucket];
+        }
+        out->print(F(";"));
+        out->print(stageNames[stage]);
+        out->print(F(":"));
+        out->print(count);
+        if (count == 0)
+        {
+            continue;
+        }
+        out->print(F(","));
+        out->print((uint32_t)(_totalCycles[stage] / count / cpuMHz));
+        out->print(F(","));
+        out->print(_maxCycles[stage] / cpuMHz);
+        out->print(F(","));
+        for (int bucket = 0; bucket < PROFILE_BUCKET_COUNT; bucket++)
+        {
+            if (_histogram[stage][bucket] > 0)
+            {
+                out->print(bucket);
+                out->print(F(":"));
+                out->print(_histogram[stage][bucket]);
+                out->print(F(" "));
+            }
+        }
+    }
+    for (int counter = 0; counter < COUNTER_COUNT; counter++)
+    {
+        out->print(F(";"));
+        out->print(counterNames[counter]);
+        out->print(F(":"));
+        out->print(_counters[counter]);
+    }
+    out->println(F(";"));
+}
@@ -0,0 +1,52 @@
+#ifndef _ESP_PROFILER_H_
+#define _ESP_PROFILER_H_
+
+#include <Arduino.h>
+
+// PI COMMAND -> STATS
+#define PROFILE_BUCKET_COUNT 32 // bucket k counts durations of [2^k, 2^(k+1)) CPU cycles
+
+enum profileStage
+{
+    STAGE_MEASUREMENT,   // updateVoltAndValue() of one sensor
+    STAGE_SAMPLE_BURST,  // one readAndAverageVolt()
+    STAGE_ADC_READ,      // one ESP32 ADC sample
+    STAGE_ADS_READ,      // one ADS1115 sample
+    STAGE_TEMPERATURE,   // one DS18B20 conversion and read
+    STAGE_DISPLAY_FLUSH, // one OLED display()
+    STAGE_REPORT,        // one sensor data report over serial
+    STAGE_COUNT
+};
+
+enum profileCounter
+{
+    COUNTER_I2C_ERROR,     // ADS1115 read failed
+    COUNTER_ONEWIRE_ERROR, // DS18B20 disconnected
+    COUNTER_COUNT
+};
+//
+
+// Always-on latency histograms per pipeline stage, timed with the CPU
+// cycle counter. Recording a duration is a handful of instructions
+// (count-leading-zeros picks the log2 bucket), so it can stay enabled
+// in the per-sample loops. Nothing is recorded while a trace is
+// replayed. No constructor, so it can live in RTC memory
+// (RTC_DATA_ATTR) and accumulate across deep sleep; call reset() once
+// at cold boot.
+class ESP_Profiler
+{
+public:
+    void reset();
+    uint32_t start();
+    void stop(byte stage, uint32_t startCycles);
+    void count(byte counter);
+    void report(Stream *out);
+
+private:
+    uint32_t _histogram[STAGE_COUNT][PROFILE_BUCKET_COUNT];
+    uint64_t _totalCycles[STAGE_COUNT];
+    uint32_t _maxCycles[STAGE_COUNT];
+    uint32_t _counters[COUNTER_COUNT];
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "ESP_Report.h"
+
+void ESP_Report::reset(bool isByException)
+{
+    _isByException = isByException;
+    _requestsSinceFullReport = FULL_REPORT_PERIOD;
+}
+
+// the counters stop at their period, so requests that keep timing out
+// do not wrap them
+void ESP_Report::select(ESP_Sensor **sensors)
+{
+    if (_requestsSinceFullReport < FULL_REPORT_PERIOD)
+    {
+        _requestsSinceFullReport++;
+    }
+    bool isFullReport = !_isByException || (_requestsSinceFullReport >= FULL_REPORT_PERIOD);
+    for (int i = 0; i < SENSOR_COUNT + MAX_TEMP_PROBES; i++)
+    {
+        bool isChanged;
+        if (i < SENSOR_COUNT)
+        {
+            // a new status is news even when both readings are nan
+            isChanged = sensors[i]->isOutsideDeadband(_lastReportedValue[i]) ||
+                        (sensors[i]->_status != _lastReportedStatus[i]);
+        }
+        else
+        {
+            float value = probeTemperature(sensors, i - SENSOR_COUNT);
+            isChanged = (fabsf(value - _lastReportedValue[i]) > TEMPERATURE_DEADBAND) ||
+                        (isnan(value) != isnan(_lastReportedValue[i]));
+        }
+        if (_requestsSinceReported[i] < HEARTBEAT_PERIOD)
+        {
+            _requestsSinceReported[i]++;
+        }
+        _isValueReported[i] = isFullReport || isChanged || (_requestsSinceReported[i] >= HEARTBEAT_PERIOD);
+    }
+}
+
+// the sensors still hold the values select() chose from
+void ESP_Report::commit(ESP_Sensor **sensors)
+{
+    if (_requestsSinceFullReport >= FULL_REPORT_PERIOD)
+    {
+        _requestsSinceFullReport = 0;
+    }
+    for (int i = 0; i < SENSOR_COUNT + MAX_TEMP_PROBES; i++)
+    {
+        if (!_isValueReported[i])
+        {
+            continue;
+        }
+        if (i < SENSOR_COUNT)
+        {
+            _lastReportedValue[i] = sensors[i]->_value;
+            _lastReportedStatus[i] = sensors[i]->_status;
+        }
+        else
+        {
+            _lastReportedValue[i] = probeTemperature(sensors, i - SENSOR_COUNT);
+        }
+        _requestsSinceReported[i] = 0;
+    }
+}
+
+void ESP_Report::send(Stream *out, String time, ESP_Sensor **sensors, unsigned long *readingAge,
+                      ESP_WindowStats *shortStats, ESP_WindowStats *longStats)
+{
+    out->print(F("Data#"));
+    out->print(F("Time:"));
+    out->print(time);
+    for (int p = 0; p < MAX_TEMP_PROBES; p++)
+    {
+        if ((p > 0) && !isProbeUsed(sensors, p))
+        {
+            continue;
+        }
+        out->print((p == 0) ? F(" ;Temperature") : F(";Temperature"));
+        if (p > 0)
+        {
+            out->print(p);
+        }
+        out->print(F(":"));
+        if (_isValueReported[SENSOR_COUNT + p])
+        {
+            out->print(probeTemperature(sensors, p));
+            out->print(F(" "));
+        }
+        else
+        {
+            out->print(F("="));
+        }
+    }
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        out->print(F(";"));
+        out->print(sensors[i]->_sensorName);
+        out->print(F(":"));
+        if (_isValueReported[i])
+        {
+            out->print(sensors[i]->_value);
+            out->print(F(" "));
+            out->print(sensors[i]->_sensorUnit);
+        }
+        else
+        {
+            out->print(F("="));
+        }
+    }
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        if (!sensors[i]->_enableSensor || !_isValueReported[i])
+        {
+            continue;
+        }
+        out->print(F(";"));
+        out->print(sensors[i]->_sensorName);
+        out->print(F("_Age:"));
+        out->print(readingAge[i]);
+        if (sensors[i]->_status != STATUS_OK)
+        {
+            out->print(F(";"));
+            out->print(sensors[i]->_sensorName);
+            out->print(F("_Status:"));
+            out->print(sensors[i]->_status);
+        }
+        sendWindowStats(out, sensors[i]->_sensorName + F("_S"), &shortStats[i]);
+        sendWindowStats(out, sensors[i]->_sensorName + F("_L"), &longStats[i]);
+        if (sensors[i]->_derivedName.length() > 0)
+        {
+            out->print(F(";"));
+            out->print(sensors[i]->_derivedName);
+            out->print(F(":"));
+            out->print(sensors[i]->_derivedValue);
+            out->print(F(" "));
+            out->print(sensors[i]->_derivedUnit);
+        }
+    }
+    out->println(F(";"));
+}
+
+bool ESP_Report::isProbeUsed(ESP_Sensor **sensors, byte probe)
+{
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        if (sensors[i]->_enableSensor && (sensors[i]->_tempProbe == probe))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// the reading of the first enabled sensor bound to the probe that read it
+// in its last measurement, nan if none did (a sensor without temperature
+// compensation never reads it, one that failed its health check before
+// the temperature may still hold an old one)
+float ESP_Report::probeTemperature(ESP_Sensor **sensors, byte probe)
+{
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        if (sensors[i]->_enableSensor && (sensors[i]->_tempProbe == probe) && !isnan(sensors[i]->_temperature) &&
+            ((sensors[i]->_status == STATUS_OK) || (sensors[i]->_status == STATUS_BAD_TEMPERATURE)))
+        {
+            return sensors[i]->_temperature;
+        }
+    }
+    return NAN;
+}
+
+// format: ;<name>:mean,min,max,stddev,count
+void ESP_Report::sendWindowStats(Stream *out, String name, ESP_WindowStats *stats)
+{
+    out->print(F(";"));
+    out->print(name);
+    out->print(F(":"));
+    out->print(stats->mean());
+    out->print(F(","));
+    out->print(stats->minimum());
+    out->print(F(","));
+    out->print(stats->maximum());
+    out->print(F(","));
+    out->print(stats->stdDev());
+    out->print(F(","));
+    out->print(stats->count());
+}
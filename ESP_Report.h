@@ -0,0 +1,48 @@
+#ifndef _ESP_REPORT_H_
+#define _ESP_REPORT_H_
+
+#include <Arduino.h>
+#include "ESP_Sensor.h"
+#include "ESP_WindowStats.h"
+
+// PI COMMAND -> SENSOR DATA
+#define REPORT_BY_EXCEPTION false // only send values that left their deadband, needs a sink that reads "="
+#define HEARTBEAT_PERIOD 6        // resend an unchanged value at least every 6 requests
+#define FULL_REPORT_PERIOD 24     // send every value every 24 requests
+#define TEMPERATURE_DEADBAND 0.2f // ^C
+//
+
+// Data# report with report-by-exception. Per request, select() decides
+// once which values the (resent) report carries, against the last
+// reported ones; the others go out as "=". commit() makes them the last
+// reported ones once the request completed, so what a timed-out request
+// carried is still news to the next one. No constructor, so it can live
+// in RTC memory (RTC_DATA_ATTR) and keep the last reported values
+// through deep sleep; call reset() once at cold boot.
+// Each temperature probe gets its own value: "Temperature" for probe 0
+// (always sent), "Temperature<probe>" for the other probes an enabled
+// sensor is bound to.
+class ESP_Report
+{
+public:
+    void reset(bool isByException = REPORT_BY_EXCEPTION); // the next report is full
+    void select(ESP_Sensor **sensors);
+    void commit(ESP_Sensor **sensors); // the request completed
+    void send(Stream *out, String time, ESP_Sensor **sensors, unsigned long *readingAge,
+              ESP_WindowStats *shortStats, ESP_WindowStats *longStats);
+    static bool isProbeUsed(ESP_Sensor **sensors, byte probe);
+    static float probeTemperature(ESP_Sensor **sensors, byte probe);
+
+private:
+    // the sensors, then one slot per temperature probe
+    float _lastReportedValue[SENSOR_COUNT + MAX_TEMP_PROBES];
+    byte _lastReportedStatus[SENSOR_COUNT];
+    byte _requestsSinceReported[SENSOR_COUNT + MAX_TEMP_PROBES];
+    byte _requestsSinceFullReport;
+    bool _isByException;
+    bool _isValueReported[SENSOR_COUNT + MAX_TEMP_PROBES];
+
+    void sendWindowStats(Stream *out, String name, ESP_WindowStats *stats);
+};
+
+#endif
@@ -5,6 +5,9 @@ extern debounceButton cal_button;
 extern debounceButton mode_button;
 extern OneWire oneWire;              // Setup a oneWire instance to communicate with any OneWire devices
 extern DallasTemperature tempSensor; // Pass our oneWire reference to Dallas Temperature sensor
+extern ESP_Trace trace;
+extern ESP_TempProbes tempProbes;
+extern ESP_Profiler profiler;
 
 ESP_Sensor::ESP_Sensor()
 {
@@ -40,6 +43,18 @@ void ESP_Sensor::begin()
         Serial.println(*_calibParamArray[i].calibVolt);
     }
 
+    // temperature probe bound to this sensor
+    _tempProbe = EEPROM.read(_eepromAddress + 1);
+    if (_tempProbe >= MAX_TEMP_PROBES) // if EEPROM is uninitialized
+    {
+        _tempProbe = 0;
+        EEPROM.write(_eepromAddress + 1, _tempProbe);
+        EEPROM.commit();
+    }
+    Serial.print(_sensorName);
+    Serial.print(F(" temperature probe in EEPROM: "));
+    Serial.println(_tempProbe);
+
     // check if sensor is set as enabled in EEPROM or not
     _enableSensor = EEPROM.read(_eepromAddress);
     Serial.print(_sensorName);
@@ -67,7 +82,9 @@ void ESP_Sensor::displayTwoLines(String firstLine, String secondLine)
     display.setCursor(0, 2);
     display.println(firstLine);
     display.println(secondLine);
+    uint32_t startCycles = profiler.start();
     display.display();
+    profiler.stop(STAGE_DISPLAY_FLUSH, startCycles);
 }
 
 // function for changing calibration state
@@ -232,34 +249,290 @@ void ESP_Sensor::updateVoltAndValue()
 {
     if (_enableSensor)
     {
+        uint32_t startCycles = profiler.start();
         displayTwoLines("Reading " + _sensorName, F(""));
+        resetRange();
+        _temperature = NAN; // stays so for a sensor without temperature compensation
+        _status = checkHealth();
+        if (_status != STATUS_OK) // skip the full acquisition of a dead channel
+        {
+            _voltage = NAN;
+            _value = NAN;
+            _derivedValue = NAN;
+            profiler.stop(STAGE_MEASUREMENT, startCycles);
+            return;
+        }
+        selectRange();
         float volt = 0;
         int m = 5;
         for (int i = 0; i < m; i++)
         {
-            readAndAverageVolt();
+            // the input can rise past a narrowed range after the pre-burst;
+            // a clipped burst would read low, so it runs again at the widest
+            if (readAndAverageVolt() && _isRangeNarrowed)
+            {
+                resetRange();
+                readAndAverageVolt();
+            }
+            if (usesTemperature())
+            {
+                _temperature = readTemperature(); // store last temperature value
+            }
+            // every reading is checked, a probe can drop out between bursts
+            if (usesTemperature() && (classifyTemperature(_temperature) != STATUS_OK))
+            {
+                _status = STATUS_BAD_TEMPERATURE;
+                _voltage = NAN;
+                _value = NAN;
+                _derivedValue = NAN;
+                profiler.stop(STAGE_MEASUREMENT, startCycles);
+                return;
+            }
             volt += compensateVoltWithTemperature();
         }
         _voltage = volt / m;
         _value = calculateValueFromVolt();
+        _derivedValue = calculateDerivedValue();
+        profiler.stop(STAGE_MEASUREMENT, startCycles);
     }
     else
     {
+        _status = STATUS_DISABLED;
         _voltage = NAN;
         _value = NAN;
+        _derivedValue = NAN;
+    }
+}
+
+// live streaming uses the widest range and one temperature reading for the
+// whole session, so a single sample costs one raw read and no conversion
+// wait. A bad reading is not used: the values stream as nan, the raw
+// codes still go
+void ESP_Sensor::startStream()
+{
+    resetRange();
+    _temperature = usesTemperature() ? readTemperature() : NAN;
+    if (classifyTemperature(_temperature) != STATUS_OK)
+    {
+        _temperature = NAN;
+    }
+    _streamVoltage = NAN;
+}
+
+// one sample through an EMA filter, returns the value and the raw code in
+// raw; a failed read keeps the last filtered value and is sent as its raw
+// code, RAW_READ_ERROR
+float ESP_Sensor::readStreamSample(int *raw)
+{
+    *raw = acquireRawSample();
+    if (!isRawReadError(*raw))
+    {
+        float volt = convertRawToVolt(*raw);
+        if (isnan(_streamVoltage))
+        {
+            _streamVoltage = volt;
+        }
+        else
+        {
+            _streamVoltage += STREAM_FILTER_ALPHA * (volt - _streamVoltage);
+        }
+    }
+    if (usesTemperature() && isnan(_temperature))
+    {
+        return NAN;
+    }
+    _voltage = _streamVoltage;
+    _voltage = compensateVoltWithTemperature();
+    return calculateValueFromVolt();
+}
+
+// short pre-burst to catch dead or saturated channels before spending
+// the full acquisition on them; stops at a failed read
+byte ESP_Sensor::checkHealth()
+{
+    int raw[HEALTH_SAMPLE_COUNT];
+    byte count = 0;
+    _coarseMaxRaw = 0;
+    while (count < HEALTH_SAMPLE_COUNT)
+    {
+        raw[count] = acquireRawSample();
+        if (raw[count] > _coarseMaxRaw)
+        {
+            _coarseMaxRaw = raw[count];
+        }
+        if (isRawReadError(raw[count++]))
+        {
+            break;
+        }
+    }
+    return classifySamples(raw, count, _rawFullScale);
+}
+
+// the pre-burst rules, first match wins: a failed read, every sample at
+// the top rail (fullScale), every sample at or below zero, every sample
+// identical
+byte ESP_Sensor::classifySamples(const int *raw, byte count, int fullScale)
+{
+    bool isAllSame = true;
+    bool isAllZero = true;
+    bool isAllFullScale = true;
+    for (int i = 0; i < count; i++)
+    {
+        if (raw[i] == RAW_READ_ERROR)
+        {
+            return STATUS_I2C_ERROR;
+        }
+        isAllSame = isAllSame && (raw[i] == raw[0]);
+        isAllZero = isAllZero && (raw[i] <= 0);
+        isAllFullScale = isAllFullScale && (raw[i] >= fullScale);
+    }
+    if (isAllFullScale)
+    {
+        return STATUS_SATURATED;
+    }
+    if (isAllZero)
+    {
+        return STATUS_OPEN_CIRCUIT;
+    }
+    if (isAllSame)
+    {
+        return STATUS_STUCK;
+    }
+    return STATUS_OK;
+}
+
+// a missing probe, the power-on value of a conversion that never ran, or
+// a reading no wastewater gets to
+byte ESP_Sensor::classifyTemperature(float temperature)
+{
+    if ((temperature == DEVICE_DISCONNECTED_C) || (temperature == TEMP_POWER_ON_VALUE) ||
+        !((temperature >= TEMP_PLAUSIBLE_MIN) && (temperature <= TEMP_PLAUSIBLE_MAX)))
+    {
+        return STATUS_BAD_TEMPERATURE;
     }
+    return STATUS_OK;
+}
+
+bool ESP_Sensor::readAndAverageVolt()
+{
+    if (trace.isReplaying())
+    {
+        trace.replayBurst();
+    }
+    else if (trace.isRecording())
+    {
+        trace.recordBurst();
+    }
+    uint32_t startCycles = profiler.start();
+    int n = 0; // failed reads are left out, a burst of them gives NAN
+    bool isClipped = false;
+    if (USE_FIXED_POINT_SAMPLING)
+    {
+        int64_t voltageQ16 = 0;
+        for (int i = 0; i < _burstSampleCount; i++)
+        {
+            int raw = acquireRawSample();
+            isClipped |= (raw >= _rawFullScale);
+            if (!isRawReadError(raw))
+            {
+                voltageQ16 += convertRawToVoltQ16(raw);
+                n++;
+            }
+        }
+        _voltage = (n > 0) ? (float)voltageQ16 / (n * 65536.0f) : NAN;
+    }
+    else
+    {
+        float voltage = 0;
+        for (int i = 0; i < _burstSampleCount; i++)
+        {
+            int raw = acquireRawSample();
+            isClipped |= (raw >= _rawFullScale);
+            if (!isRawReadError(raw))
+            {
+                voltage += convertRawToVolt(raw);
+                n++;
+            }
+        }
+        _voltage = (n > 0) ? voltage / n : NAN;
+    }
+    profiler.stop(STAGE_SAMPLE_BURST, startCycles);
+    return isClipped;
+}
+
+// virtual for EC (look ESP_EC.cpp)
+int ESP_Sensor::readRawSample()
+{
+    return analogRead(_sensorPin);
 }
 
 // virtual for EC (look ESP_EC.cpp)
-void ESP_Sensor::readAndAverageVolt()
+float ESP_Sensor::convertRawToVolt(int raw)
 {
-    float voltage = 0;
-    int n = 100;
-    for (int i = 0; i < n; i++)
+    return raw * (3300.0f / 4095.0f);
+}
+
+// virtual for EC (look ESP_EC.cpp)
+int32_t ESP_Sensor::convertRawToVoltQ16(int raw)
+{
+    return raw * ADC_MV_PER_CODE_Q16;
+}
+
+// virtual for EC (look ESP_EC.cpp)
+void ESP_Sensor::resetRange()
+{
+    _burstSampleCount = BURST_SAMPLE_COUNT;
+    _isRangeNarrowed = false;
+}
+
+// virtual for EC (look ESP_EC.cpp). The ESP32 ADC stays at its default
+// 11 dB: each attenuation has its own offset and gain error, so the
+// same input would read differently at another one and the calibration
+// voltages, taken at 11 dB, would no longer match.
+void ESP_Sensor::selectRange()
+{
+}
+
+// the ESP32 ADC has no failed read, the ADS1115 can (look ESP_EC.cpp)
+bool ESP_Sensor::isRawReadError(int raw)
+{
+    return raw == RAW_READ_ERROR;
+}
+
+int ESP_Sensor::acquireRawSample()
+{
+    if (trace.isReplaying())
+    {
+        return trace.replaySample();
+    }
+    uint32_t startCycles = profiler.start();
+    int raw = readRawSample();
+    profiler.stop(_rawReadStage, startCycles);
+    if (trace.isRecording())
+    {
+        trace.recordSample(raw);
+    }
+    return raw;
+}
+
+float ESP_Sensor::readTemperature()
+{
+    if (trace.isReplaying())
     {
-        voltage += (analogRead(_sensorPin) / 4095.0) * 3300;
+        return trace.replayTemperature();
     }
-    _voltage = voltage / n;
+    uint32_t startCycles = profiler.start();
+    float temperature = tempProbes.read(_tempProbe);
+    profiler.stop(STAGE_TEMPERATURE, startCycles);
+    if (temperature == DEVICE_DISCONNECTED_C)
+    {
+        profiler.count(COUNTER_ONEWIRE_ERROR);
+    }
+    if (trace.isRecording())
+    {
+        trace.recordTemperature(temperature);
+    }
+    return temperature;
 }
 
 void ESP_Sensor::saveNewConfig()
@@ -269,6 +542,11 @@ void ESP_Sensor::saveNewConfig()
         EEPROM.write(_eepromAddress, _enableSensor);
         EEPROM.commit();
     }
+    if (_tempProbe != EEPROM.read(_eepromAddress + 1))
+    {
+        EEPROM.write(_eepromAddress + 1, _tempProbe);
+        EEPROM.commit();
+    }
 }
 
 void ESP_Sensor::saveNewCalib()
@@ -285,6 +563,31 @@ void ESP_Sensor::saveNewCalib()
     }
 }
 
+// linear site correlation, coefficients set by each sensor's constructor
+float ESP_Sensor::calculateDerivedValue()
+{
+    if (_derivedName.length() == 0)
+    {
+        return NAN;
+    }
+    return _derivedSlope * _value + _derivedIntercept;
+}
+
+// true if the value moved enough since lastValue to be worth reporting
+bool ESP_Sensor::isOutsideDeadband(float lastValue)
+{
+    if (isnan(_value) || isnan(lastValue))
+    {
+        return isnan(_value) != isnan(lastValue);
+    }
+    float band = _deadband;
+    if (_isDeadbandRelative)
+    {
+        band = _deadband * fabsf(lastValue);
+    }
+    return fabsf(_value - lastValue) > band;
+}
+
 bool ESP_Sensor::isTbdOutOfRange()
 {
     return false;
@@ -292,7 +595,11 @@ bool ESP_Sensor::isTbdOutOfRange()
 
 float ESP_Sensor::compensateVoltWithTemperature()
 { // default, no temp compensation for volt
-    tempSensor.requestTemperatures();
-    _temperature = tempSensor.getTempCByIndex(0); // store last temperature value
     return _voltage;
 }
+
+// virtual, true for the sensors that override compensateVoltWithTemperature()
+bool ESP_Sensor::usesTemperature()
+{
+    return false;
+}
@@ -5,11 +5,14 @@
 #include <Arduino.h>
 #include <math.h>
 #include <EEPROM.h>
+
+#define SENSOR_COUNT 4 // total number of main sensors, enabled+disabled
 //
 
 // PI COMMAND -> SENSOR DATA
 #include <DallasTemperature.h>
 #include <OneWire.h>
+#include "ESP_TempProbes.h"
 //
 
 // ONSITE INPUT
@@ -22,12 +25,46 @@
 #include "debounceButton.h"
 //
 
+// PI COMMAND -> TRACE
+#include "ESP_Trace.h"
+//
+
+// PI COMMAND -> STATS
+#include "ESP_Profiler.h"
+//
+
 // ONSITE (CALIBRATION)
 #define CALCULATE_PERIOD 5000U
 //
 
 // PI COMMAND -> SENSOR DATA
 #define ONE_WIRE_BUS 4 // temperature sensor
+#define USE_FIXED_POINT_SAMPLING false // per-sample conversion in Q16.16 integer math instead of float
+#define ADC_MV_PER_CODE_Q16 52813       // 3300 / 4095 mV in Q16.16
+#define RAW_READ_ERROR -1               // readRawSample() result of a failed read
+#define HEALTH_SAMPLE_COUNT 10          // pre-burst samples checked before the full acquisition
+#define AUTO_RANGING true               // narrow the ADS1115 gain to the pre-burst peak
+#define AUTORANGE_HEADROOM 0.2f         // keep 20 % of the range above the pre-burst peak
+#define BURST_SAMPLE_COUNT 100          // samples per burst at the widest range
+#define RANGED_BURST_SAMPLE_COUNT 25    // samples per burst once the gain was narrowed, see test_ranging
+#define TEMP_PLAUSIBLE_MIN -5.0f        // ^C, wastewater outside this range means a bad probe
+#define TEMP_PLAUSIBLE_MAX 60.0f
+#define TEMP_POWER_ON_VALUE 85.0f       // DS18B20 reset value, the conversion never ran
+
+enum sensorStatus
+{
+    STATUS_OK,
+    STATUS_DISABLED,
+    STATUS_I2C_ERROR,       // ADS1115 not answering
+    STATUS_SATURATED,       // every sample at the top rail
+    STATUS_OPEN_CIRCUIT,    // every sample at zero, probe or board unplugged
+    STATUS_STUCK,           // every sample identical, no signal noise at all
+    STATUS_BAD_TEMPERATURE  // compensation probe missing or implausible
+};
+//
+
+// PI COMMAND -> STREAM
+#define STREAM_FILTER_ALPHA 0.2f // EMA weight of a new sample while streaming
 //
 
 class ESP_Sensor
@@ -42,17 +79,27 @@ public:
     void saveNewConfig();
     void saveNewCalib();
     void displayTwoLines(String firstLine, String secondLine);
+    void startStream();
+    float readStreamSample(int *raw);
 
     float _value;
     float _temperature;
     String _sensorName;
     String _sensorUnit;
+    float _derivedValue;  // e.g. TSS converted from EC or turbidity, NAN if none
+    String _derivedName;  // empty if the sensor has no derived quantity
+    String _derivedUnit;
     bool _resetCalibratedValueToDefault = 0;
     int _calibParamCount; // the amount of value in eeprom array for each sensor
 
     virtual bool isTbdOutOfRange();
+    bool isOutsideDeadband(float lastValue);
+    static byte classifySamples(const int *raw, byte count, int fullScale); // sensorStatus of a pre-burst
+    static byte classifyTemperature(float temperature);
 
     bool _enableSensor;
+    byte _status = STATUS_OK; // sensorStatus of the last measurement
+    byte _tempProbe; // temperature probe used for compensation, stored after _enableSensor
 
     struct eepromCalibParam
     {
@@ -65,14 +112,35 @@ protected:
     int _eepromStartAddress;
     int _eepromAddress;
     int _sensorPin;
+    byte _rawReadStage = STAGE_ADC_READ; // profiler stage of readRawSample()
+    int _rawFullScale = 4095;            // top rail of readRawSample()
+    int _coarseMaxRaw;                   // largest pre-burst sample, for range selection
+    int _burstSampleCount = BURST_SAMPLE_COUNT;
+    bool _isRangeNarrowed = false;       // selectRange() left the widest range
+    float _derivedSlope = 0; // derived = slope * value + intercept
+    float _derivedIntercept = 0;
+    float _deadband = 0; // report-by-exception threshold
+    bool _isDeadbandRelative = false; // deadband as fraction of last reported value
+    float _streamVoltage; // filtered mV while streaming, NAN before the first sample
 
     void calibDisplay(byte calibParamIdx);
     void captureCalibVolt(bool *calibrationFinish, byte calibParamIdx);
     void saveCalibVoltAndExit(bool *calibrationFinish);
 
     virtual float compensateVoltWithTemperature();
-    virtual void readAndAverageVolt(); // to facilitate EC difference
+    virtual bool usesTemperature(); // reads and checks its temperature probe
+    virtual bool readAndAverageVolt(); // true when a sample hit _rawFullScale
+    virtual int readRawSample();             // to facilitate EC difference (ADS1115)
+    virtual float convertRawToVolt(int raw); // in mV
+    virtual int32_t convertRawToVoltQ16(int raw); // in mV, Q16.16
     virtual float calculateValueFromVolt() = 0;
+    bool isRawReadError(int raw);
+    virtual void resetRange();  // widest range, for the pre-burst
+    virtual void selectRange(); // narrowest range that fits _coarseMaxRaw with headroom
+    int acquireRawSample();   // hardware read, recorded to or replayed from the trace
+    byte checkHealth();
+    float readTemperature(); // same for the temperature sensor
+    float calculateDerivedValue();
 };
 
 #endif
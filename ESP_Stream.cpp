@@ -0,0 +1,176 @@
+#include "ESP_Stream.h"
+
+ESP_Stream::ESP_Stream(HardwareSerial *serial, ESP_Link *link, uint8_t stopPin)
+{
+    _serial = serial;
+    _link = link;
+    _stopPin = stopPin;
+    _sensors = NULL;
+    _queue = NULL;
+    _isStreaming = false;
+    _isTaskDone = true;
+    _mask = 0;
+    _period = 1000UL / STREAM_DEFAULT_RATE;
+    _dropCount = 0;
+}
+
+// "stream" alone or with parameters after a colon
+bool ESP_Stream::isCommand(const String &inString)
+{
+    return (inString == "stream") || inString.startsWith("stream:");
+}
+
+// "stream[:<sensor mask>,<rate Hz>,<raw 0/1>,<timeout s>]", any field may be left empty
+// format: Stream#<rate>;<sensor>,...;raw:<0/1>
+//         S<sequence>,<ms>,<value>,...[,<raw>,...]   one line per frame, raw -1 for a failed read
+//         Stream#end;frames:<sent>;drops:<dropped>
+void ESP_Stream::run(String inString, ESP_Sensor **sensors)
+{
+    String parameters = inString.substring(7);
+    unsigned long param[] = {0xFF, STREAM_DEFAULT_RATE, 0, STREAM_DEFAULT_TIMEOUT};
+    int start = 0;
+    for (int i = 0; (i < 4) && (start < (int)parameters.length()); i++)
+    {
+        int comma = parameters.indexOf(',', start);
+        if (comma < 0)
+        {
+            comma = parameters.length();
+        }
+        if (comma > start)
+        {
+            param[i] = parameters.substring(start, comma).toInt();
+        }
+        start = comma + 1;
+    }
+    _sensors = sensors;
+    _mask = 0;
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        if (bitRead(param[0], i) && sensors[i]->_enableSensor)
+        {
+            bitSet(_mask, i);
+        }
+    }
+    if (_mask == 0)
+    {
+        _serial->println(F("streamerror"));
+        return;
+    }
+    unsigned long rate = constrain(param[1], 1UL, STREAM_MAX_RATE);
+    bool isRawStreamed = param[2];
+    unsigned long timeout = constrain(param[3], 1UL, STREAM_MAX_TIMEOUT) * 1000UL;
+
+    sensors[0]->displayTwoLines(F("Streaming"), String(rate) + F(" Hz"));
+    _serial->print(F("Stream#"));
+    _serial->print(rate);
+    _serial->print(F(";"));
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        if (bitRead(_mask, i))
+        {
+            sensors[i]->startStream();
+            _serial->print(sensors[i]->_sensorName);
+            _serial->print(F(","));
+        }
+    }
+    _serial->print(F(";raw:"));
+    _serial->println(isRawStreamed);
+
+    _period = 1000UL / rate;
+    _dropCount = 0;
+    _queue = xQueueCreate(STREAM_QUEUE_LENGTH, sizeof(frame));
+    _isStreaming = true;
+    _isTaskDone = false;
+    xTaskCreatePinnedToCore(task, "stream", STREAM_TASK_STACK, this, 1, NULL, 0); // loop() runs on core 1
+
+    unsigned long startTime = millis();
+    unsigned long frameCount = 0;
+    String inLine;
+    frame received;
+    while (_isStreaming)
+    {
+        if (xQueueReceive(_queue, &received, pdMS_TO_TICKS(_period)) == pdTRUE)
+        {
+            sendFrame(received, isRawStreamed);
+            frameCount++;
+        }
+        // non-blocking, the sampling task keeps running meanwhile
+        if (_link->pollLine(&inLine) && (inLine == "stop"))
+        {
+            _isStreaming = false;
+        }
+        if ((millis() - startTime > timeout) || !digitalRead(_stopPin))
+        {
+            _isStreaming = false;
+        }
+    }
+    while (!_isTaskDone)
+    {
+        delay(1);
+    }
+    _dropCount += uxQueueMessagesWaiting(_queue); // sampled but no longer sent
+    vQueueDelete(_queue);
+    _serial->print(F("Stream#end;frames:"));
+    _serial->print(frameCount);
+    _serial->print(F(";drops:"));
+    _serial->println(_dropCount);
+}
+
+// sampling side of the stream on the other core, paced by the tick count
+// so a link slower than the samples shows up as drops, not as a lower rate
+void ESP_Stream::task(void *parameter)
+{
+    ((ESP_Stream *)parameter)->sample();
+    vTaskDelete(NULL);
+}
+
+void ESP_Stream::sample()
+{
+    frame sampled;
+    unsigned long startTime = millis();
+    TickType_t lastWake = xTaskGetTickCount();
+    sampled.sequence = 0;
+    while (_isStreaming)
+    {
+        sampled.time = millis() - startTime;
+        for (int i = 0; i < SENSOR_COUNT; i++)
+        {
+            if (bitRead(_mask, i))
+            {
+                sampled.value[i] = _sensors[i]->readStreamSample(&sampled.raw[i]);
+            }
+        }
+        if (xQueueSend(_queue, &sampled, 0) != pdTRUE) // queue full, the link falls behind
+        {
+            _dropCount++;
+        }
+        sampled.sequence++;
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(_period));
+    }
+    _isTaskDone = true;
+}
+
+void ESP_Stream::sendFrame(const frame &sent, bool isRawStreamed)
+{
+    _serial->print(F("S"));
+    _serial->print(sent.sequence);
+    _serial->print(F(","));
+    _serial->print(sent.time);
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        if (bitRead(_mask, i))
+        {
+            _serial->print(F(","));
+            _serial->print(sent.value[i], 3);
+        }
+    }
+    for (int i = 0; isRawStreamed && (i < SENSOR_COUNT); i++)
+    {
+        if (bitRead(_mask, i))
+        {
+            _serial->print(F(","));
+            _serial->print(sent.raw[i]);
+        }
+    }
+    _serial->println();
+}
@@ -0,0 +1,56 @@
+#ifndef _ESP_STREAM_H_
+#define _ESP_STREAM_H_
+
+#include <Arduino.h>
+#include "ESP_Sensor.h"
+#include "ESP_Link.h"
+
+// PI COMMAND -> STREAM
+#define STREAM_MAX_RATE 50UL      // Hz, sample frames per second while streaming
+#define STREAM_DEFAULT_RATE 10UL  // Hz
+#define STREAM_MAX_TIMEOUT 600UL  // s, a stream ends by itself after this at the latest
+#define STREAM_DEFAULT_TIMEOUT 60UL
+#define STREAM_QUEUE_LENGTH 32    // frames buffered between the sampling task and the link
+#define STREAM_TASK_STACK 4096
+//
+
+// Live streaming of filtered sensor values for commissioning. A task on
+// the other core samples at the requested rate, paced by the tick count,
+// and queues frames; run() sends them over the link until "stop", the
+// timeout or the stop pin going low. A link slower than the samples
+// fills the queue and whole frames are dropped, seen as gaps in the
+// sequence numbers, instead of slowing the sampling. Every sampled frame
+// is either sent or counted as a drop.
+class ESP_Stream
+{
+public:
+    ESP_Stream(HardwareSerial *serial, ESP_Link *link, uint8_t stopPin);
+    static bool isCommand(const String &inString);
+    void run(String inString, ESP_Sensor **sensors);
+
+private:
+    struct frame
+    {
+        unsigned long sequence; // counts dropped frames too, so gaps show on the sink
+        unsigned long time;     // ms since the stream started
+        float value[SENSOR_COUNT];
+        int raw[SENSOR_COUNT];
+    };
+
+    HardwareSerial *_serial;
+    ESP_Link *_link;
+    uint8_t _stopPin;
+    ESP_Sensor **_sensors;
+    QueueHandle_t _queue;
+    volatile bool _isStreaming;
+    volatile bool _isTaskDone;
+    byte _mask;             // bit per sensor index
+    unsigned long _period;  // ms
+    volatile unsigned long _dropCount;
+
+    static void task(void *parameter);
+    void sample();
+    void sendFrame(const frame &frame, bool isRawStreamed);
+};
+
+#endif
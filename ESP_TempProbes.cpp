@@ -0,0 +1,144 @@
+#include "ESP_TempProbes.h"
+
+ESP_TempProbes::ESP_TempProbes(OneWire *oneWire, DallasTemperature *sensors)
+{
+    _oneWire = oneWire;
+    _sensors = sensors;
+    _count = 0;
+    _isParasite = false;
+}
+
+void ESP_TempProbes::begin()
+{
+    _sensors->setWaitForConversion(false); // the wait follows the probe resolution, see read()
+    _count = EEPROM.read(TEMP_PROBE_EEPROM_ADDRESS);
+    if ((_count == 0) || (_count > MAX_TEMP_PROBES)) // new EEPROM or no probe found last time
+    {
+        enumerate();
+        return;
+    }
+    int eepromAddr = TEMP_PROBE_EEPROM_ADDRESS + 1;
+    for (int i = 0; i < _count; i++)
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            _address[i][j] = EEPROM.read(eepromAddr + i * 8 + j);
+        }
+        _resolution[i] = EEPROM.read(eepromAddr + MAX_TEMP_PROBES * 8 + i);
+        if ((_resolution[i] < 9) || (_resolution[i] > 12))
+        {
+            _resolution[i] = DEFAULT_TEMP_RESOLUTION;
+        }
+    }
+    byte parasite = EEPROM.read(eepromAddr + MAX_TEMP_PROBES * 9);
+    if (parasite <= 1)
+    {
+        _isParasite = parasite;
+    }
+    else // stored before the flag was kept: ask the bus once
+    {
+        _isParasite = _sensors->readPowerSupply(NULL);
+        save();
+    }
+}
+
+byte ESP_TempProbes::enumerate()
+{
+    _sensors->begin(); // bus search
+    _count = _sensors->getDeviceCount();
+    _isParasite = _sensors->isParasitePowerMode();
+    if (_count > MAX_TEMP_PROBES)
+    {
+        _count = MAX_TEMP_PROBES;
+    }
+    for (int i = 0; i < _count; i++)
+    {
+        _sensors->getAddress(_address[i], i);
+        _resolution[i] = _sensors->getResolution(_address[i]);
+        if ((_resolution[i] < 9) || (_resolution[i] > 12))
+        {
+            _resolution[i] = DEFAULT_TEMP_RESOLUTION;
+            _sensors->setResolution(_address[i], _resolution[i], true);
+        }
+    }
+    _sensors->setWaitForConversion(false);
+    save();
+    return _count;
+}
+
+byte ESP_TempProbes::count()
+{
+    return _count;
+}
+
+// one addressed conversion and one scratchpad read, DEVICE_DISCONNECTED_C
+// if the probe is missing or its scratchpad fails the CRC
+float ESP_TempProbes::read(byte probe)
+{
+    if (probe >= _count)
+    {
+        return DEVICE_DISCONNECTED_C;
+    }
+    if (_oneWire->reset() == 0) // no presence pulse, nothing on the bus
+    {
+        return DEVICE_DISCONNECTED_C;
+    }
+    _oneWire->select(_address[probe]);
+    _oneWire->write(STARTCONVO, _isParasite); // strong pull-up until the scratchpad read
+    delay(_sensors->millisToWaitForConversion(_resolution[probe]));
+    return _sensors->getTempC(_address[probe]);
+}
+
+bool ESP_TempProbes::setResolution(byte probe, byte bits)
+{
+    if ((probe >= _count) || (bits < 9) || (bits > 12))
+    {
+        return false;
+    }
+    if (!_sensors->setResolution(_address[probe], bits, true))
+    {
+        return false;
+    }
+    _resolution[probe] = bits;
+    save();
+    return true;
+}
+
+// format: Probes#<probe>:<rom address>,<resolution>;...
+void ESP_TempProbes::report(Stream *out)
+{
+    out->print(F("Probes#"));
+    for (int i = 0; i < _count; i++)
+    {
+        out->print(i);
+        out->print(F(":"));
+        for (int j = 0; j < 8; j++)
+        {
+            if (_address[i][j] < 0x10)
+            {
+                out->print(F("0"));
+            }
+            out->print(_address[i][j], HEX);
+        }
+        out->print(F(","));
+        out->print(_resolution[i]);
+        out->print(F(";"));
+    }
+    out->println();
+}
+
+void ESP_TempProbes::save()
+{
+    EEPROM.write(TEMP_PROBE_EEPROM_ADDRESS, _count);
+    int eepromAddr = TEMP_PROBE_EEPROM_ADDRESS + 1;
+    for (int i = 0; i < _count; i++)
+    {
+        for (int j = 0; j < 8; j++)
+        {
+            EEPROM.write(eepromAddr + i * 8 + j, _address[i][j]);
+        }
+        EEPROM.write(eepromAddr + MAX_TEMP_PROBES * 8 + i, _resolution[i]);
+    }
+    EEPROM.write(eepromAddr + MAX_TEMP_PROBES * 9, _isParasite);
+    EEPROM.commit();
+}
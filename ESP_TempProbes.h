@@ -0,0 +1,47 @@
+#ifndef _ESP_TEMPPROBES_H_
+#define _ESP_TEMPPROBES_H_
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <DallasTemperature.h>
+#include <OneWire.h>
+
+// PI COMMAND -> TEMPERATURE PROBES
+#define MAX_TEMP_PROBES 4
+#define TEMP_PROBE_EEPROM_ADDRESS 110 // probe count, ROM addresses, resolutions, then parasite power
+#define DEFAULT_TEMP_RESOLUTION 12    // bits; 9 bits converts in ~94 ms, 12 bits in ~750 ms
+//
+
+// DS18B20 probes on the OneWire bus. The bus is searched once (first boot
+// or on request) and the ROM addresses are kept in EEPROM, so every read
+// afterwards is a single addressed conversion with no bus search, and
+// the conversion wait follows the stored resolution of that probe. The
+// conversion is started on the bus directly: the library's
+// requestTemperaturesByAddress() first reads the whole scratchpad to
+// learn the resolution, which is already known here. Whether a probe on
+// the bus is parasite powered is kept with the addresses too: those
+// need the strong pull-up during the conversion.
+class ESP_TempProbes
+{
+public:
+    ESP_TempProbes(OneWire *oneWire, DallasTemperature *sensors);
+
+    void begin();
+    byte enumerate(); // search the bus and store what is found
+    byte count();
+    float read(byte probe);
+    bool setResolution(byte probe, byte bits);
+    void report(Stream *out);
+
+private:
+    OneWire *_oneWire;
+    DallasTemperature *_sensors;
+    byte _count;
+    DeviceAddress _address[MAX_TEMP_PROBES];
+    byte _resolution[MAX_TEMP_PROBES];
+    bool _isParasite;
+
+    void save();
+};
+
+#endif
@@ -0,0 +1,276 @@
+#include "ESP_Trace.h"
+#include "ESP_Sensor.h"
+
+ESP_Trace::ESP_Trace()
+{
+    _length = 0;
+    _position = 0;
+    _isRecording = false;
+    _isReplaying = false;
+    _isError = false;
+}
+
+void ESP_Trace::startRecording()
+{
+    _length = 0;
+    _isError = false;
+    _isReplaying = false;
+    _isRecording = true;
+}
+
+void ESP_Trace::startReplay()
+{
+    _position = 0;
+    _isError = false;
+    _isRecording = false;
+    _isReplaying = true;
+}
+
+void ESP_Trace::stop()
+{
+    _isRecording = false;
+    _isReplaying = false;
+}
+
+bool ESP_Trace::isRecording()
+{
+    return _isRecording;
+}
+
+bool ESP_Trace::isReplaying()
+{
+    return _isReplaying;
+}
+
+bool ESP_Trace::isError()
+{
+    return _isError;
+}
+
+void ESP_Trace::recordBurst()
+{
+    unsigned long timestamp = millis();
+    writeByte(TRACE_TAG_BURST);
+    write(&timestamp, 4);
+}
+
+void ESP_Trace::recordSample(int raw)
+{
+    int16_t sample = raw;
+    writeByte(TRACE_TAG_SAMPLE);
+    write(&sample, 2);
+}
+
+void ESP_Trace::recordTemperature(float temperature)
+{
+    writeByte(TRACE_TAG_TEMPERATURE);
+    writeFloat(temperature);
+}
+
+void ESP_Trace::replayBurst()
+{
+    unsigned long timestamp = 0;
+    if (expectTag(TRACE_TAG_BURST))
+    {
+        read(&timestamp, 4); // recorded timing is informative only
+    }
+}
+
+int ESP_Trace::replaySample()
+{
+    int16_t sample = 0;
+    if (expectTag(TRACE_TAG_SAMPLE))
+    {
+        read(&sample, 2);
+    }
+    return sample;
+}
+
+float ESP_Trace::replayTemperature()
+{
+    if (expectTag(TRACE_TAG_TEMPERATURE))
+    {
+        return readFloat();
+    }
+    return NAN;
+}
+
+void ESP_Trace::writeByte(byte value)
+{
+    write(&value, 1);
+}
+
+void ESP_Trace::writeFloat(float value)
+{
+    write(&value, 4);
+}
+
+byte ESP_Trace::readByte()
+{
+    byte value = 0;
+    read(&value, 1);
+    return value;
+}
+
+float ESP_Trace::readFloat()
+{
+    float value = NAN;
+    read(&value, 4);
+    return value;
+}
+
+void ESP_Trace::write(const void *data, unsigned int size)
+{
+    if (_length + size > TRACE_BUFFER_SIZE)
+    {
+        _isError = true; // overflow, keep what fits
+        return;
+    }
+    memcpy(_buffer + _length, data, size);
+    _length += size;
+}
+
+void ESP_Trace::read(void *data, unsigned int size)
+{
+    if (_position + size > _length)
+    {
+        _isError = true; // trace ended early
+        return;
+    }
+    memcpy(data, _buffer + _position, size);
+    _position += size;
+}
+
+bool ESP_Trace::expectTag(byte tag)
+{
+    if (readByte() != tag)
+    {
+        _isError = true; // recorded cycle differs from the replayed one
+        return false;
+    }
+    return true;
+}
+
+// header: 'W' 'T' version sensor_count, then per sensor:
+// enabled calib_param_count calib_volt..., then the acquisition
+// settings of the build: AUTO_RANGING AUTORANGE_HEADROOM
+// USE_FIXED_POINT_SAMPLING HEALTH_SAMPLE_COUNT BURST_SAMPLE_COUNT
+// RANGED_BURST_SAMPLE_COUNT (counts as float)
+void ESP_Trace::writeHeader(ESP_Sensor **sensors)
+{
+    writeByte('W');
+    writeByte('T');
+    writeByte(TRACE_VERSION);
+    writeByte(SENSOR_COUNT);
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        writeByte(sensors[i]->_enableSensor);
+        writeByte(sensors[i]->_calibParamCount);
+        for (int j = 0; j < sensors[i]->_calibParamCount; j++)
+        {
+            writeFloat(*sensors[i]->_calibParamArray[j].calibVolt);
+        }
+    }
+    writeByte(AUTO_RANGING);
+    writeFloat(AUTORANGE_HEADROOM);
+    writeByte(USE_FIXED_POINT_SAMPLING);
+    writeFloat(HEALTH_SAMPLE_COUNT);
+    writeFloat(BURST_SAMPLE_COUNT);
+    writeFloat(RANGED_BURST_SAMPLE_COUNT);
+}
+
+// sets the recorded enables and calibrations on the sensors
+bool ESP_Trace::readHeader(ESP_Sensor **sensors)
+{
+    if ((readByte() != 'W') || (readByte() != 'T') || (readByte() != TRACE_VERSION) ||
+        (readByte() != SENSOR_COUNT))
+    {
+        return false;
+    }
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        sensors[i]->_enableSensor = readByte();
+        if (readByte() != sensors[i]->_calibParamCount)
+        {
+            return false;
+        }
+        for (int j = 0; j < sensors[i]->_calibParamCount; j++)
+        {
+            *sensors[i]->_calibParamArray[j].calibVolt = readFloat();
+        }
+    }
+    return !_isError;
+}
+
+// the samples per burst and the ranges depend on these, so a trace only
+// replays on a build with the same settings
+bool ESP_Trace::readAcquisitionConfig()
+{
+    return (readByte() == AUTO_RANGING) && (readFloat() == AUTORANGE_HEADROOM) &&
+           (readByte() == USE_FIXED_POINT_SAMPLING) && (readFloat() == HEALTH_SAMPLE_COUNT) &&
+           (readFloat() == BURST_SAMPLE_COUNT) && (readFloat() == RANGED_BURST_SAMPLE_COUNT);
+}
+
+// format: "Trace#<length>", hex lines of TRACE_LINE_BYTES bytes, "Trace#end"
+void ESP_Trace::dump(Stream *out)
+{
+    out->print(F("Trace#"));
+    out->println(_length);
+    for (unsigned int i = 0; i < _length; i++)
+    {
+        if (_buffer[i] < 0x10)
+        {
+            out->print(F("0"));
+        }
+        out->print(_buffer[i], HEX);
+        if ((i % TRACE_LINE_BYTES == TRACE_LINE_BYTES - 1) || (i == _length - 1))
+        {
+            out->println();
+        }
+    }
+    out->println(F("Trace#end"));
+}
+
+// reads back the format written by dump()
+bool ESP_Trace::load(Stream *in)
+{
+    String inString = in->readStringUntil('\n');
+    inString.trim();
+    if (!inString.startsWith(F("Trace#")))
+    {
+        return false;
+    }
+    unsigned int expectedLength = inString.substring(6).toInt();
+    if (expectedLength > TRACE_BUFFER_SIZE)
+    {
+        return false;
+    }
+    _length = 0;
+    _isError = false;
+    stop();
+    while (true)
+    {
+        inString = in->readStringUntil('\n');
+        inString.trim();
+        if (inString == F("Trace#end"))
+        {
+            break;
+        }
+        if ((inString.length() == 0) || (inString.length() % 2 != 0))
+        {
+            return false; // serial timeout or broken line
+        }
+        for (unsigned int i = 0; i < inString.length(); i += 2)
+        {
+            char hex[3] = {inString[i], inString[i + 1], 0};
+            char *end;
+            byte value = strtoul(hex, &end, 16);
+            if (*end != 0)
+            {
+                return false;
+            }
+            writeByte(value);
+        }
+    }
+    return (_length == expectedLength) && !_isError;
+}
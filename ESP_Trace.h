@@ -0,0 +1,71 @@
+#ifndef _ESP_TRACE_H_
+#define _ESP_TRACE_H_
+
+#include <Arduino.h>
+
+class ESP_Sensor;
+
+// RAW ACQUISITION TRACE
+#define TRACE_BUFFER_SIZE 8192U // one full measurement cycle of all sensors fits
+#define TRACE_VERSION 4
+#define TRACE_LINE_BYTES 64     // bytes per hex line when dumping over serial
+
+// record tags
+#define TRACE_TAG_BURST 'B'       // start of a sample burst, followed by millis() as uint32
+#define TRACE_TAG_SAMPLE 'S'      // raw ADC code (ESP32 ADC or ADS1115 counts) as int16
+#define TRACE_TAG_TEMPERATURE 'T' // DS18B20 reading in ^C as float
+//
+
+// Compact binary trace of the raw inputs of a measurement cycle.
+// While recording, the sensor classes append every raw sample,
+// temperature and burst timestamp; while replaying, they read them back
+// in the same order instead of touching the hardware, so a recorded
+// cycle goes through the unmodified conversion code deterministically.
+class ESP_Trace
+{
+public:
+    ESP_Trace();
+
+    void startRecording();
+    void startReplay();
+    void stop();
+    bool isRecording();
+    bool isReplaying();
+    bool isError(); // overflow while recording, or trace mismatch while replaying
+
+    // raw records, used by ESP_Sensor
+    void recordBurst();
+    void recordSample(int raw);
+    void recordTemperature(float temperature);
+    void replayBurst();
+    int replaySample();
+    float replayTemperature();
+
+    // untagged fields, used for the trace header
+    void writeByte(byte value);
+    void writeFloat(float value);
+    byte readByte();
+    float readFloat();
+
+    // configuration of the recording node, see writeHeader()
+    void writeHeader(ESP_Sensor **sensors);
+    bool readHeader(ESP_Sensor **sensors);
+    bool readAcquisitionConfig();
+
+    void dump(Stream *out);
+    bool load(Stream *in);
+
+private:
+    byte _buffer[TRACE_BUFFER_SIZE];
+    unsigned int _length;
+    unsigned int _position;
+    bool _isRecording;
+    bool _isReplaying;
+    bool _isError;
+
+    void write(const void *data, unsigned int size);
+    void read(void *data, unsigned int size);
+    bool expectTag(byte tag);
+};
+
+#endif
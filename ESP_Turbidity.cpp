@@ -31,6 +31,13 @@ ESP_Turbidity::ESP_Turbidity()
     _calibParamCount = 3;
     _sensorUnit = "NTU";
     _sensorPin = 32;
+    _deadband = TBD_DEADBAND;
+    _isDeadbandRelative = true;
+
+    _derivedName = "TSS_Tbd";
+    _derivedUnit = "mg/L";
+    _derivedSlope = NTU_TSS_SLOPE;
+    _derivedIntercept = NTU_TSS_INTERCEPT;
 }
 
 ESP_Turbidity::~ESP_Turbidity()
@@ -71,15 +78,15 @@ float ESP_Turbidity::calculateValueFromVolt()
     float b = (x3 * x3 * (y1 - y2) + x2 * x2 * (y3 - y1) + x1 * x1 * (y2 - y3)) / denom;
     float c = (x2 * x3 * (x2 - x3) * y1 + x3 * x1 * (x3 - x1) * y2 + x1 * x2 * (x1 - x2) * y3) / denom;
 
-    _vPeak = -b / (2 * a);
-    float ntu_peak = a * pow(_vPeak, 2.0) + b * _vPeak + c;
+    _vPeak = -b / (2.0f * a);
+    float ntu_peak = (a * _vPeak + b) * _vPeak + c;
     if (isTbdOutOfRange())
     {
         value = ntu_peak;
     }
     else
     {
-        value = a * pow(_voltage, 2.0) + b * _voltage + c; // y = a*x^2 + b*x + c
+        value = (a * _voltage + b) * _voltage + c; // y = a*x^2 + b*x + c
     }
     return value;
 }
@@ -87,8 +94,11 @@ float ESP_Turbidity::calculateValueFromVolt()
 float ESP_Turbidity::compensateVoltWithTemperature()
 {
     float voltage;
-    tempSensor.requestTemperatures();
-    _temperature = tempSensor.getTempCByIndex(0); // store last temperature value
     voltage = (1455 * _voltage - 3795 * _temperature + 94875) / (2 * _temperature + 1405);
     return voltage;
-}
\ No newline at end of file
+}
+
+bool ESP_Turbidity::usesTemperature()
+{
+    return true;
+}
@@ -13,9 +13,12 @@
 
 #include "ESP_Sensor.h"
 
-#define TRANSPARENT_VALUE 0.0
-#define TRANSLUCENT_VALUE 304.5
-#define OPAQUE_VALUE 511.5
+#define TRANSPARENT_VALUE 0.0f
+#define TRANSLUCENT_VALUE 304.5f
+#define OPAQUE_VALUE 511.5f
+#define NTU_TSS_SLOPE 1.5f // mg/L TSS per NTU, site correlation
+#define NTU_TSS_INTERCEPT 0.0f
+#define TBD_DEADBAND 0.05f // fraction of last reported value
 
 class ESP_Turbidity : public ESP_Sensor
 {
@@ -32,6 +35,7 @@ private:
 
     float calculateValueFromVolt();
     float compensateVoltWithTemperature();
+    bool usesTemperature();
 };
 
 #endif
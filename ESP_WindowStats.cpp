@@ -0,0 +1,134 @@
+#include "ESP_WindowStats.h"
+
+void ESP_WindowStats::reset(byte horizon)
+{
+    _horizon = constrain(horizon, 1, STATS_WINDOW_CAPACITY);
+    _seq = 0;
+    _count = 0;
+    _shift = 0;
+    _sum = 0;
+    _sumSq = 0;
+    _minHead = 0;
+    _minSize = 0;
+    _maxHead = 0;
+    _maxSize = 0;
+}
+
+void ESP_WindowStats::push(float value)
+{
+    if (isnan(value)) // disabled sensor, nothing to aggregate
+    {
+        return;
+    }
+    if (_count == 0)
+    {
+        _shift = value;
+    }
+    if (_count == _horizon) // drop the reading leaving the window
+    {
+        float leaving = valueAt(_seq - _horizon) - _shift;
+        _sum -= leaving;
+        _sumSq -= leaving * leaving;
+        _count--;
+    }
+    _buffer[_seq % STATS_WINDOW_CAPACITY] = value;
+    float d = value - _shift;
+    _sum += d;
+    _sumSq += d * d;
+    _count++;
+
+    pushDeque(_minDeque, &_minHead, &_minSize, value, true);
+    pushDeque(_maxDeque, &_maxHead, &_maxSize, value, false);
+    _seq++;
+
+    // once per full window, rebuild the sums around the current mean
+    // so rounding error from the subtractions cannot accumulate
+    if ((_count == _horizon) && (_seq % _horizon == 0))
+    {
+        _shift = mean();
+        _sum = 0;
+        _sumSq = 0;
+        for (unsigned long s = _seq - _count; s < _seq; s++)
+        {
+            d = valueAt(s) - _shift;
+            _sum += d;
+            _sumSq += d * d;
+        }
+    }
+}
+
+void ESP_WindowStats::pushDeque(unsigned long *deque, byte *head, byte *size, float value, bool isMin)
+{
+    // expire readings that slid out of the window
+    while ((*size > 0) && (deque[*head] + _horizon <= _seq))
+    {
+        *head = (*head + 1) % STATS_WINDOW_CAPACITY;
+        (*size)--;
+    }
+    // drop readings that can never be the extreme again
+    while (*size > 0)
+    {
+        float back = valueAt(deque[(*head + *size - 1) % STATS_WINDOW_CAPACITY]);
+        if ((isMin && (back >= value)) || (!isMin && (back <= value)))
+        {
+            (*size)--;
+        }
+        else
+        {
+            break;
+        }
+    }
+    deque[(*head + *size) % STATS_WINDOW_CAPACITY] = _seq;
+    (*size)++;
+}
+
+float ESP_WindowStats::valueAt(unsigned long seq)
+{
+    return _buffer[seq % STATS_WINDOW_CAPACITY];
+}
+
+byte ESP_WindowStats::count()
+{
+    return _count;
+}
+
+float ESP_WindowStats::mean()
+{
+    if (_count == 0)
+    {
+        return NAN;
+    }
+    return _shift + _sum / _count;
+}
+
+float ESP_WindowStats::minimum()
+{
+    if (_minSize == 0)
+    {
+        return NAN;
+    }
+    return valueAt(_minDeque[_minHead]);
+}
+
+float ESP_WindowStats::maximum()
+{
+    if (_maxSize == 0)
+    {
+        return NAN;
+    }
+    return valueAt(_maxDeque[_maxHead]);
+}
+
+float ESP_WindowStats::stdDev()
+{
+    if (_count < 2)
+    {
+        return 0;
+    }
+    float variance = (_sumSq - _sum * _sum / _count) / (_count - 1);
+    if (variance < 0) // rounding on a flat window
+    {
+        variance = 0;
+    }
+    return sqrtf(variance);
+}
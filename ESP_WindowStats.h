@@ -0,0 +1,52 @@
+#ifndef _ESP_WINDOWSTATS_H_
+#define _ESP_WINDOWSTATS_H_
+
+#include <Arduino.h>
+#include <math.h>
+
+// ROLLING STATISTICS
+#define STATS_WINDOW_CAPACITY 24 // max readings kept per window (fixed memory)
+#define STATS_SHORT_HORIZON 6    // short window, in measurements (timer wakes and measuring requests)
+#define STATS_LONG_HORIZON 24    // long window, in measurements
+//
+
+// Fixed-memory sliding window over the last `horizon` readings.
+// Every push is O(1) amortized: mean and stddev use running sums,
+// min and max use monotonic deques of reading sequence numbers.
+// No constructor, so an array of these can live in RTC memory
+// (RTC_DATA_ATTR) and survive deep sleep; call reset() once at cold boot.
+class ESP_WindowStats
+{
+public:
+    void reset(byte horizon);
+    void push(float value);
+
+    byte count();
+    float mean();
+    float minimum();
+    float maximum();
+    float stdDev();
+
+private:
+    float _buffer[STATS_WINDOW_CAPACITY]; // readings, indexed by sequence % capacity
+    unsigned long _seq;                   // sequence number of the next reading
+    byte _horizon;
+    byte _count;
+
+    // running sums are shifted by the first reading to keep float variance stable
+    float _shift;
+    float _sum;
+    float _sumSq;
+
+    unsigned long _minDeque[STATS_WINDOW_CAPACITY]; // increasing values
+    byte _minHead;
+    byte _minSize;
+    unsigned long _maxDeque[STATS_WINDOW_CAPACITY]; // decreasing values
+    byte _maxHead;
+    byte _maxSize;
+
+    float valueAt(unsigned long seq);
+    void pushDeque(unsigned long *deque, byte *head, byte *size, float value, bool isMin);
+};
+
+#endif
@@ -3,9 +3,14 @@
 #include "ESP_PH.h"
 #include "ESP_Turbidity.h"
 #include "ESP_NH3N.h"
+#include "ESP_WindowStats.h"
+#include "ESP_Report.h"
+#include "ESP_Trace.h"
+#include "ESP_Profiler.h"
+#include "ESP_Link.h"
+#include "ESP_Stream.h"
 
 #define BUTTON_PIN_BITMASK 0x4004000  // pin 14 & 26 as wakeup trigger (2^14 + 2^26)
-#define SENSOR_COUNT 4                // total number of main sensors, enabled+disabled
 #define DATA_RESEND_PERIOD 1000U      // resend data per 1000 ms
 //
 
@@ -22,15 +27,49 @@
 
 // PI COMMAND
 #define PI_PIN 26  // for GPIO, receive request from Raspi
+#define CACHE_MAX_AGE 300U        // s, older cached readings are measured again on request (0: always measure)
+#define CACHE_REFRESH_PERIOD 240U // s, timer wake to refresh the cached readings (0: no timer wake)
 
 String piTime;  // waktu dari Raspi
+
+ESP_Link sinkLink(&Serial);  // baud rate negotiation and fallback
+ESP_Stream liveStream(&Serial, &sinkLink, PI_PIN);  // until "stop", the timeout or PI_PIN going low
 //
 
 // GENERAL
 ESP_Sensor **sensors = new ESP_Sensor *[SENSOR_COUNT];
 
-OneWire oneWire(ONE_WIRE_BUS);           // Setup a oneWire instance to communicate with any OneWire devices
-DallasTemperature tempSensor(&oneWire);  // Pass our oneWire reference to Dallas Temperature sensor
+OneWire oneWire(ONE_WIRE_BUS);                     // Setup a oneWire instance to communicate with any OneWire devices
+DallasTemperature tempSensor(&oneWire);            // Pass our oneWire reference to Dallas Temperature sensor
+ESP_TempProbes tempProbes(&oneWire, &tempSensor);  // probe ROM addresses, searched once and kept in EEPROM
+//
+
+// PI COMMAND -> SENSOR DATA
+// rolling windows over past readings, kept in RTC memory through deep sleep
+RTC_DATA_ATTR ESP_WindowStats shortStats[SENSOR_COUNT];
+RTC_DATA_ATTR ESP_WindowStats longStats[SENSOR_COUNT];
+RTC_DATA_ATTR bool isRtcMemoryInitialized = false;
+
+RTC_DATA_ATTR ESP_Report report;  // last reported values, for report-by-exception
+
+// readings cache, so a request can be answered without measuring
+RTC_DATA_ATTR bool isCacheValid = false;
+RTC_DATA_ATTR float cachedValue[SENSOR_COUNT];
+RTC_DATA_ATTR float cachedDerivedValue[SENSOR_COUNT];
+RTC_DATA_ATTR float cachedTemperature[SENSOR_COUNT];
+RTC_DATA_ATTR byte cachedStatus[SENSOR_COUNT];
+RTC_DATA_ATTR bool cachedIsOutOfRange[SENSOR_COUNT];  // turbidity above the calibrated peak, see displayMain()
+RTC_DATA_ATTR time_t cachedTime[SENSOR_COUNT];  // RTC clock keeps running in deep sleep
+bool isFreshRequested = false;
+unsigned long readingAge[SENSOR_COUNT];  // s, at the time of the request
+//
+
+// PI COMMAND -> TRACE
+ESP_Trace trace;  // raw inputs of one measurement cycle, for replay
+//
+
+// PI COMMAND -> STATS
+RTC_DATA_ATTR ESP_Profiler profiler;  // stage latencies, kept through deep sleep
 //
 
 // ONSITE OUTPUT
@@ -45,17 +84,20 @@ debounceButton mode_button(MODE_PIN);
 
 void setup() {
   // GENERAL
-  Serial.begin(9600);
+  sinkLink.begin();
   Serial.setTimeout(3000);  // set serial timeout to 3 seconds
 
   EEPROM.begin(256);
 
   Serial.println("Node number: " + String((byte)EEPROM.read(100)));
 
-  tempSensor.begin();  // temperature sensor init
+  tempProbes.begin();  // temperature sensor init
 
   esp_sleep_enable_ext1_wakeup(BUTTON_PIN_BITMASK,
                                ESP_EXT1_WAKEUP_ANY_HIGH);  // wake up trigger
+  if (CACHE_REFRESH_PERIOD > 0) {
+    esp_sleep_enable_timer_wakeup(CACHE_REFRESH_PERIOD * 1000000ULL);  // readings cache refresh
+  }
 
   sensors[0] = new ESP_EC;
   sensors[1] = new ESP_Turbidity;
@@ -65,6 +107,16 @@ void setup() {
   for (int i = 0; i < SENSOR_COUNT; i++) {
     sensors[i]->begin();
   }
+
+  if (!isRtcMemoryInitialized) {  // cold boot, RTC memory is not valid yet
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+      shortStats[i].reset(STATS_SHORT_HORIZON);
+      longStats[i].reset(STATS_LONG_HORIZON);
+    }
+    profiler.reset();
+    report.reset();  // first report after cold boot is full
+    isRtcMemoryInitialized = true;
+  }
   //
 
   // ONSITE OUTPUT
@@ -91,11 +143,17 @@ void setup() {
   Serial.print("PI Pin: ");
   Serial.println(digitalRead(PI_PIN));
 
+  if ((esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER) && !digitalRead(PI_PIN)) {
+    measureAllSensors();
+    displayMain();  // the fresh readings stay on screen until the next request
+    isDisplayMain = true;
+  }
+
   while (digitalRead(PI_PIN)) {  // JIKA MENERIMA REQUEST DARI RASPI
     static unsigned long timepoint = 0U;
     sensors[0]->displayTwoLines(F("Reading Serial"),
                                 F("waiting for cmd"));
-    String inString = Serial.readStringUntil('\n');
+    String inString = sinkLink.readCommand();
     // while requesting sensor data, raspi will send local time
     if (isPiTime(inString)) {
       display.println(F("responding req"));
@@ -115,6 +173,46 @@ void setup() {
       sendInitAndProcessNewData(&sendCalibInitData,
                                 &processNewCalib);
       break;
+    } else if (inString == "fresh") {
+      isFreshRequested = true;  // then keep waiting for the time
+    } else if (inString.startsWith("baud")) {
+      if (sinkLink.negotiate(inString)) {  // then keep waiting for the actual command
+        sensors[0]->displayTwoLines(F("Link speed (baud)"), String(sinkLink.baudRate()));
+      }
+    } else if (inString == "probes") {
+      sendProbeConfig();
+      break;
+    } else if (inString == "probescan") {
+      display.println(F("scanning probes"));
+      display.display();
+      tempProbes.enumerate();
+      sendProbeConfig();
+      break;
+    } else if (inString.startsWith("probeset:")) {
+      processProbeSetting(inString.substring(9));
+      break;
+    } else if (inString == "stats") {
+      display.println(F("sending stats"));
+      display.display();
+      profiler.report(&Serial);
+      break;
+    } else if (inString == "statsreset") {
+      profiler.reset();
+      Serial.println(F("statsresetdone"));
+      break;
+    } else if (ESP_Stream::isCommand(inString)) {
+      liveStream.run(inString, sensors);
+      break;
+    } else if (inString == "trace") {
+      display.println(F("recording trace"));
+      display.display();
+      recordTrace();
+      break;
+    } else if (inString == "replay") {
+      display.println(F("replaying trace"));
+      display.display();
+      replayTrace();
+      break;
     } else if (millis() - timepoint > 30000U) {  // timeout
       sensors[0]->displayTwoLines(F("Request timeout"),
                                   inString);
@@ -132,6 +230,7 @@ void setup() {
     }
     esp_deep_sleep_start();
   }
+  isCacheValid = false;  // calibration may change the readings
   //
 }
 
@@ -177,9 +276,15 @@ bool isPiTime(String inStr) {
 
 // PI COMMAND -> SENSOR DATA
 void dataRequestResponse() {
+  if (isFreshRequested || !isCacheFresh()) {
+    measureAllSensors();
+  } else {
+    loadReadingsCache();
+  }
   for (int i = 0; i < SENSOR_COUNT; i++) {
-    sensors[i]->updateVoltAndValue();
+    readingAge[i] = time(NULL) - cachedTime[i];
   }
+  report.select(sensors);
   sensors[0]->displayTwoLines(F("Send sensor data"), F(""));
   unsigned long timepoint = millis() - DATA_RESEND_PERIOD;
   unsigned long timepoint1 = millis();
@@ -187,35 +292,60 @@ void dataRequestResponse() {
   // until pi pin turned off (request finished)
   while (digitalRead(PI_PIN) && (millis() - timepoint1 < 60000U)) {
     if (millis() - timepoint > DATA_RESEND_PERIOD) {
-      Serial.print(F("Data#"));
-      Serial.print(F("Time:"));
-      Serial.print(piTime);
-      bool isTemperatureSent = 0;
-      for (int i = 0; i < SENSOR_COUNT; i++) {
-        if (isTemperatureSent == 0) {
-          Serial.print(F(" ;Temperature:"));
-          Serial.print(sensors[i]->_temperature);
-          Serial.print(F(" "));
-          isTemperatureSent = 1;
-        }
-        Serial.print(F(";"));
-        Serial.print(sensors[i]->_sensorName);
-        Serial.print(F(":"));
-        Serial.print(sensors[i]->_value);
-        Serial.print(F(" "));
-        Serial.print(sensors[i]->_sensorUnit);
-      }
-      Serial.println(F(";"));
+      uint32_t startCycles = profiler.start();
+      report.send(&Serial, piTime, sensors, readingAge, shortStats, longStats);
+      profiler.stop(STAGE_REPORT, startCycles);
       timepoint = millis();
     }
+    sinkLink.checkErrors();  // a sink that lost the rate gets "baudreset"
   }
   if (digitalRead(PI_PIN)) {
     sensors[0]->displayTwoLines(F("Error (timeout)"),
                                 F("PI_PIN still on"));
     delay(1000);
+  } else {
+    report.commit(sensors);  // the sink got the report
   }
   displayMain();
 }
+
+// measures every sensor and stores the readings in the statistics
+// windows and the readings cache
+void measureAllSensors() {
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    sensors[i]->updateVoltAndValue();
+    shortStats[i].push(sensors[i]->_value);
+    longStats[i].push(sensors[i]->_value);
+    cachedValue[i] = sensors[i]->_value;
+    cachedDerivedValue[i] = sensors[i]->_derivedValue;
+    cachedTemperature[i] = sensors[i]->_temperature;
+    cachedStatus[i] = sensors[i]->_status;
+    cachedIsOutOfRange[i] = sensors[i]->isTbdOutOfRange();
+    cachedTime[i] = time(NULL);
+  }
+  isCacheValid = true;
+}
+
+bool isCacheFresh() {
+  if (!isCacheValid) {
+    return false;
+  }
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    if (time(NULL) - cachedTime[i] > CACHE_MAX_AGE) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void loadReadingsCache() {
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    sensors[i]->_value = cachedValue[i];
+    sensors[i]->_derivedValue = cachedDerivedValue[i];
+    sensors[i]->_temperature = cachedTemperature[i];
+    sensors[i]->_status = cachedStatus[i];
+  }
+}
 //
 
 // ONSITE OUTPUT
@@ -227,14 +357,16 @@ void displayMain() {
   for (int i = 0; i < SENSOR_COUNT; i++) {
     if (sensors[i]->_enableSensor) {
       if (isTemperatureDisplayed == 0) {
-        display.println("Temp: " + String(sensors[i]->_temperature, 2) + "^C");
+        display.println("Temp: " + String(ESP_Report::probeTemperature(sensors, sensors[i]->_tempProbe), 2) + "^C");
         isTemperatureDisplayed = 1;
       }
       display.print(sensors[i]->_sensorName + ": ");
-      if (sensors[i]->_sensorName == "Tbd") {
-        if (sensors[i]->isTbdOutOfRange()) {
-          display.print(F(">"));
-        }
+      if (sensors[i]->_status != STATUS_OK) {
+        display.println("error " + String(sensors[i]->_status));
+        continue;
+      }
+      if (cachedIsOutOfRange[i]) {  // the voltage it depends on is not kept with a cached reading
+        display.print(F(">"));
       }
       display.print(sensors[i]->_value, 2);
       display.println(" " + sensors[i]->_sensorUnit);
@@ -256,7 +388,7 @@ void sendInitAndProcessNewData(void (*sendInitData)(), void (*processNewData)())
       timepoint = millis();
     }
     sensors[0]->displayTwoLines(F("Reading Serial"), F(""));
-    inString = Serial.readStringUntil('\n');
+    inString = sinkLink.readCommand();
   }
   if (!digitalRead(PI_PIN)) {
     sensors[0]->displayTwoLines(F("Raspi is"), F("disconnected"));
@@ -318,6 +450,7 @@ void sendCalibInitData() {
 
 void processNewCalib() {
   Serial.println(F("newdatareceived"));
+  isCacheValid = false;
   for (int i = 0; i < SENSOR_COUNT; i++) {
     if (!sensors[i]->_enableSensor) {
       continue;
@@ -346,6 +479,7 @@ void sendConfigInitData() {
 
 void processNewConfig() {
   Serial.println(F("newdatareceived"));
+  isCacheValid = false;
   for (int i = 0; i < SENSOR_COUNT; i++) {
     byte inInt = Serial.parseInt();
     sensors[i]->_enableSensor = inInt;
@@ -353,4 +487,115 @@ void processNewConfig() {
   }
   sensors[0]->displayTwoLines(F("Configuration"), F("successful"));
 }
-//
\ No newline at end of file
+//
+
+// PI COMMAND -> TEMPERATURE PROBES
+// format: Probes#<probe>:<rom address>,<resolution>;...
+//         Bind#<sensor>:<probe>;...
+void sendProbeConfig() {
+  tempProbes.report(&Serial);
+  Serial.print(F("Bind#"));
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    Serial.print(sensors[i]->_sensorName);
+    Serial.print(F(":"));
+    Serial.print(sensors[i]->_tempProbe);
+    Serial.print(F(";"));
+  }
+  Serial.println();
+}
+
+// "<sensor index>,<probe>,<resolution bits>": binds the sensor to the
+// probe and sets the conversion resolution of that probe
+void processProbeSetting(String inString) {
+  int firstComma = inString.indexOf(',');
+  int secondComma = inString.indexOf(',', firstComma + 1);
+  int sensor = inString.substring(0, firstComma).toInt();
+  int probe = inString.substring(firstComma + 1, secondComma).toInt();
+  int bits = inString.substring(secondComma + 1).toInt();
+  if ((firstComma < 0) || (secondComma < 0) || (sensor < 0) || (sensor >= SENSOR_COUNT) || (probe < 0) || !tempProbes.setResolution(probe, bits)) {
+    Serial.println(F("probeseterror"));
+    return;
+  }
+  sensors[sensor]->_tempProbe = probe;
+  sensors[sensor]->saveNewConfig();
+  isCacheValid = false;
+  sendProbeConfig();
+}
+//
+
+// PI COMMAND -> TRACE
+// measure all sensors once while recording their raw inputs,
+// then dump the trace over serial
+void recordTrace() {
+  trace.startRecording();
+  trace.writeHeader(sensors);
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    sensors[i]->updateVoltAndValue();
+  }
+  trace.stop();
+  sensors[0]->displayTwoLines(F("Send trace"), F(""));
+  trace.dump(&Serial);
+  if (trace.isError()) {
+    Serial.println(F("Trace#overflow"));
+  }
+}
+
+// receive a dumped trace, run it through the sensor classes
+// with the recorded configuration and send the resulting values
+void replayTrace() {
+  sensors[0]->displayTwoLines(F("Reading trace"), F(""));
+  if (!trace.load(&Serial)) {
+    Serial.println(F("Trace#loaderror"));
+    sensors[0]->displayTwoLines(F("Trace load"), F("failed"));
+    delay(1000);
+    return;
+  }
+  // keep the node's own configuration, the trace brings its own
+  bool enableSensor[SENSOR_COUNT];
+  float calibVolt[SENSOR_COUNT][3];
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    enableSensor[i] = sensors[i]->_enableSensor;
+    for (int j = 0; j < sensors[i]->_calibParamCount; j++) {
+      calibVolt[i][j] = *sensors[i]->_calibParamArray[j].calibVolt;
+    }
+  }
+  trace.startReplay();
+  bool isHeaderValid = trace.readHeader(sensors);
+  bool isConfigSame = isHeaderValid && trace.readAcquisitionConfig();
+  if (isConfigSame) {
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+      sensors[i]->updateVoltAndValue();
+    }
+  }
+  trace.stop();
+  if (isHeaderValid && !isConfigSame) {
+    Serial.println(F("Trace#configerror"));  // recorded by a build with other acquisition settings
+  } else if (!isHeaderValid || trace.isError()) {
+    Serial.println(F("Trace#replayerror"));
+  } else {
+    Serial.print(F("Replay#Temperature:"));
+    Serial.print(ESP_Report::probeTemperature(sensors, 0));
+    for (int p = 1; p < MAX_TEMP_PROBES; p++) {
+      if (ESP_Report::isProbeUsed(sensors, p)) {
+        Serial.print(F(";Temperature"));
+        Serial.print(p);
+        Serial.print(F(":"));
+        Serial.print(ESP_Report::probeTemperature(sensors, p));
+      }
+    }
+    for (int i = 0; i < SENSOR_COUNT; i++) {
+      Serial.print(F(";"));
+      Serial.print(sensors[i]->_sensorName);
+      Serial.print(F(":"));
+      Serial.print(sensors[i]->_value, 4);
+    }
+    Serial.println(F(";"));
+  }
+  for (int i = 0; i < SENSOR_COUNT; i++) {
+    sensors[i]->_enableSensor = enableSensor[i];
+    for (int j = 0; j < sensors[i]->_calibParamCount; j++) {
+      *sensors[i]->_calibParamArray[j].calibVolt = calibVolt[i][j];
+    }
+  }
+}
+//
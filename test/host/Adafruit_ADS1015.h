@@ -0,0 +1,81 @@
+// host shim of the Adafruit_ADS1015 1.x library the sketch uses, talking
+// to the simulated ADS1115 in Wire.cpp the same way the library does
+#ifndef _HOST_ADAFRUIT_ADS1015_H_
+#define _HOST_ADAFRUIT_ADS1015_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define ADS1015_ADDRESS (0x48)
+#define ADS1015_CONVERSIONDELAY (1)
+#define ADS1115_CONVERSIONDELAY (8)
+#define ADS1015_REG_POINTER_CONVERT (0x00)
+#define ADS1015_REG_POINTER_CONFIG (0x01)
+#define ADS1015_REG_CONFIG_OS_SINGLE (0x8000)
+#define ADS1015_REG_CONFIG_MUX_SINGLE_0 (0x4000)
+#define ADS1015_REG_CONFIG_MUX_SINGLE_1 (0x5000)
+#define ADS1015_REG_CONFIG_MUX_SINGLE_2 (0x6000)
+#define ADS1015_REG_CONFIG_MUX_SINGLE_3 (0x7000)
+#define ADS1015_REG_CONFIG_PGA_6_144V (0x0000)
+#define ADS1015_REG_CONFIG_PGA_4_096V (0x0200)
+#define ADS1015_REG_CONFIG_PGA_2_048V (0x0400)
+#define ADS1015_REG_CONFIG_PGA_1_024V (0x0600)
+#define ADS1015_REG_CONFIG_PGA_0_512V (0x0800)
+#define ADS1015_REG_CONFIG_PGA_0_256V (0x0A00)
+#define ADS1015_REG_CONFIG_MODE_SINGLE (0x0100)
+#define ADS1015_REG_CONFIG_DR_1600SPS (0x0080)
+#define ADS1015_REG_CONFIG_CMODE_TRAD (0x0000)
+#define ADS1015_REG_CONFIG_CPOL_ACTVLOW (0x0000)
+#define ADS1015_REG_CONFIG_CLAT_NONLAT (0x0000)
+#define ADS1015_REG_CONFIG_CQUE_NONE (0x0003)
+
+typedef enum
+{
+    GAIN_TWOTHIRDS = ADS1015_REG_CONFIG_PGA_6_144V,
+    GAIN_ONE = ADS1015_REG_CONFIG_PGA_4_096V,
+    GAIN_TWO = ADS1015_REG_CONFIG_PGA_2_048V,
+    GAIN_FOUR = ADS1015_REG_CONFIG_PGA_1_024V,
+    GAIN_EIGHT = ADS1015_REG_CONFIG_PGA_0_512V,
+    GAIN_SIXTEEN = ADS1015_REG_CONFIG_PGA_0_256V
+} adsGain_t;
+
+class Adafruit_ADS1015
+{
+public:
+    Adafruit_ADS1015(uint8_t i2cAddress = ADS1015_ADDRESS) : m_i2cAddress(i2cAddress), m_gain(GAIN_TWOTHIRDS) {}
+    void begin() { Wire.begin(); }
+    void setGain(adsGain_t gain) { m_gain = gain; }
+    adsGain_t getGain() { return m_gain; }
+    uint16_t readADC_SingleEnded(uint8_t channel)
+    {
+        uint16_t config = ADS1015_REG_CONFIG_CQUE_NONE | ADS1015_REG_CONFIG_CLAT_NONLAT |
+                          ADS1015_REG_CONFIG_CPOL_ACTVLOW | ADS1015_REG_CONFIG_CMODE_TRAD |
+                          ADS1015_REG_CONFIG_DR_1600SPS | ADS1015_REG_CONFIG_MODE_SINGLE | m_gain |
+                          (ADS1015_REG_CONFIG_MUX_SINGLE_0 + 0x1000 * channel) | ADS1015_REG_CONFIG_OS_SINGLE;
+        Wire.beginTransmission(m_i2cAddress);
+        Wire.write(ADS1015_REG_POINTER_CONFIG);
+        Wire.write(config >> 8);
+        Wire.write(config & 0xFF);
+        Wire.endTransmission();
+        delay(ADS1115_CONVERSIONDELAY);
+        Wire.beginTransmission(m_i2cAddress);
+        Wire.write(ADS1015_REG_POINTER_CONVERT);
+        Wire.endTransmission();
+        Wire.requestFrom(m_i2cAddress, (uint8_t)2);
+        uint16_t high = Wire.read();
+        uint16_t low = Wire.read();
+        return (high << 8) | low; // like the library: a failed read gives 0xFFFF
+    }
+
+protected:
+    uint8_t m_i2cAddress;
+    adsGain_t m_gain;
+};
+
+class Adafruit_ADS1115 : public Adafruit_ADS1015
+{
+public:
+    Adafruit_ADS1115(uint8_t i2cAddress = ADS1015_ADDRESS) : Adafruit_ADS1015(i2cAddress) {}
+};
+
+#endif
@@ -0,0 +1,7 @@
+// host shim, the display below does not draw anything
+#ifndef _HOST_ADAFRUIT_GFX_H_
+#define _HOST_ADAFRUIT_GFX_H_
+
+#include <Arduino.h>
+
+#endif
@@ -0,0 +1,26 @@
+// host shim of the OLED driver: text goes nowhere, display() is counted
+#ifndef _HOST_ADAFRUIT_SH110X_H_
+#define _HOST_ADAFRUIT_SH110X_H_
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#define SH110X_WHITE 1
+
+class Adafruit_SH1106G : public Print
+{
+public:
+    Adafruit_SH1106G(uint16_t width, uint16_t height, TwoWire *wire, int8_t resetPin) {}
+    bool begin(uint8_t address, bool reset) { return true; }
+    void setTextSize(uint8_t size) {}
+    void setTextColor(uint16_t color) {}
+    void setCursor(int16_t x, int16_t y) {}
+    void clearDisplay() {}
+    void display() { _flushCount++; }
+    size_t write(uint8_t c) { return 1; }
+    using Print::write;
+
+    unsigned long _flushCount = 0;
+};
+
+#endif
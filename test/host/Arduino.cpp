@@ -0,0 +1,274 @@
+#include "Arduino.h"
+#include "EEPROM.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+EEPROMClass EEPROM;
+
+int hostDigitalLevel[40];
+static int noAnalogInput(uint8_t pin)
+{
+    return 0;
+}
+int (*hostAnalogRead)(uint8_t pin) = noAnalogInput;
+
+static std::atomic<unsigned long long> skippedMicros(0);
+
+static unsigned long long hostMicros()
+{
+    static const auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + skippedMicros;
+}
+
+unsigned long millis()
+{
+    return hostMicros() / 1000;
+}
+
+unsigned long micros()
+{
+    return hostMicros();
+}
+
+void delay(unsigned long ms)
+{
+    skippedMicros += ms * 1000ULL;
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    skippedMicros += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+}
+
+int digitalRead(uint8_t pin)
+{
+    return hostDigitalLevel[pin];
+}
+
+int analogRead(uint8_t pin)
+{
+    return hostAnalogRead(pin);
+}
+
+uint32_t EspClass::getCycleCount()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() * 240 / 1000);
+}
+
+// Stream, same timeout behaviour as the Arduino core
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = read();
+        if (c >= 0)
+        {
+            return c;
+        }
+        std::this_thread::yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+int Stream::timedPeek()
+{
+    unsigned long start = millis();
+    do
+    {
+        int c = peek();
+        if (c >= 0)
+        {
+            return c;
+        }
+        std::this_thread::yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+String Stream::readStringUntil(char terminator)
+{
+    String s;
+    int c = timedRead();
+    while ((c >= 0) && (c != terminator))
+    {
+        s += (char)c;
+        c = timedRead();
+    }
+    return s;
+}
+
+String Stream::readString()
+{
+    String s;
+    int c = timedRead();
+    while (c >= 0)
+    {
+        s += (char)c;
+        c = timedRead();
+    }
+    return s;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length)
+{
+    size_t count = 0;
+    while (count < length)
+    {
+        int c = timedRead();
+        if (c < 0)
+        {
+            break;
+        }
+        buffer[count++] = (char)c;
+    }
+    return count;
+}
+
+long Stream::parseInt()
+{
+    int c = timedPeek();
+    while ((c >= 0) && (c != '-') && !isdigit(c))
+    {
+        read();
+        c = timedPeek();
+    }
+    String s;
+    while ((c >= 0) && ((c == '-' && s.length() == 0) || isdigit(c)))
+    {
+        s += (char)read();
+        c = timedPeek();
+    }
+    return s.toInt();
+}
+
+float Stream::parseFloat()
+{
+    int c = timedPeek();
+    while ((c >= 0) && (c != '-') && (c != '.') && !isdigit(c))
+    {
+        read();
+        c = timedPeek();
+    }
+    String s;
+    while ((c >= 0) && ((c == '-' && s.length() == 0) || (c == '.') || isdigit(c)))
+    {
+        s += (char)read();
+        c = timedPeek();
+    }
+    return s.toFloat();
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    if (_fd < 0)
+    {
+        _transmitted.push_back((char)c);
+        return 1;
+    }
+    hostPaceByte(&_nextByteTime, _baudRate);
+    if (hostPeerBaudRate != _baudRate)
+    {
+        c |= 0x80;
+    }
+    return ::write(_fd, &c, 1) == 1 ? 1 : 0;
+}
+
+void HardwareSerial::flush()
+{
+    if (_fd >= 0)
+    {
+        std::this_thread::sleep_until(_nextByteTime);
+    }
+}
+
+void HardwareSerial::receiveFromPty()
+{
+    if (_fd < 0)
+    {
+        return;
+    }
+    uint8_t buffer[256];
+    ssize_t count = ::read(_fd, buffer, sizeof(buffer));
+    bool isFrameError = false;
+    for (ssize_t i = 0; i < count; i++)
+    {
+        isFrameError |= (buffer[i] & 0x80) != 0;
+        _received.push_back((char)buffer[i]);
+    }
+    if (isFrameError && _onReceiveError)
+    {
+        _onReceiveError(UART_FRAME_ERROR);
+    }
+}
+
+int HardwareSerial::available()
+{
+    receiveFromPty();
+    return _received.size();
+}
+
+int HardwareSerial::read()
+{
+    receiveFromPty();
+    if (_received.empty())
+    {
+        return -1;
+    }
+    int c = (uint8_t)_received[0];
+    _received.erase(0, 1);
+    return c;
+}
+
+int HardwareSerial::peek()
+{
+    receiveFromPty();
+    return _received.empty() ? -1 : (uint8_t)_received[0];
+}
+
+void HardwareSerial::hostReceive(const String &data)
+{
+    _received += data;
+}
+
+String HardwareSerial::hostTransmitted()
+{
+    return String(_transmitted);
+}
+
+void HardwareSerial::hostClear()
+{
+    _received.clear();
+    _transmitted.clear();
+}
+
+void HardwareSerial::hostAttach(int fd)
+{
+    _fd = fd;
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+    _nextByteTime = std::chrono::steady_clock::now();
+}
+
+void hostPaceByte(std::chrono::steady_clock::time_point *nextByteTime, unsigned long baudRate)
+{
+    auto byteTime = std::chrono::nanoseconds(10000000000ULL / baudRate);
+    auto now = std::chrono::steady_clock::now();
+    if (*nextByteTime + std::chrono::milliseconds(2) < now) // idle line; shorter gaps are sleep overshoot
+    {
+        *nextByteTime = now;
+    }
+    *nextByteTime += byteTime;
+    std::this_thread::sleep_until(*nextByteTime); // the byte is received after its stop bit
+}
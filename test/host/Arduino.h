@@ -0,0 +1,315 @@
+// Host shim of the Arduino core: just enough of it to build the sketch's
+// classes with g++ for the tests in test/
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <ctype.h>
+#include <string>
+#include <functional>
+#include <atomic>
+#include <chrono>
+
+#include "FreeRTOS.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define INPUT_PULLDOWN 0x09
+#define DEC 10
+#define HEX 16
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+class String : public std::string
+{
+public:
+    String() {}
+    String(const char *s) : std::string(s) {}
+    String(const std::string &s) : std::string(s) {}
+    String(const __FlashStringHelper *s) : std::string(reinterpret_cast<const char *>(s)) {}
+    explicit String(char c) : std::string(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10) { *this = fromInteger(value, base); }
+    explicit String(int value, unsigned char base = 10) { *this = fromInteger(value, base); }
+    explicit String(unsigned int value, unsigned char base = 10) { *this = fromInteger(value, base); }
+    explicit String(long value, unsigned char base = 10) { *this = fromInteger(value, base); }
+    explicit String(unsigned long value, unsigned char base = 10) { *this = fromInteger(value, base); }
+    explicit String(float value, unsigned int decimals = 2) { *this = fromDouble(value, decimals); }
+    explicit String(double value, unsigned int decimals = 2) { *this = fromDouble(value, decimals); }
+
+    unsigned int length() const { return size(); }
+    char charAt(unsigned int index) const { return index < size() ? at(index) : 0; }
+    bool equals(const String &s) const { return *this == s; }
+    bool startsWith(const String &prefix) const { return compare(0, prefix.size(), prefix) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return size() >= suffix.size() && compare(size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const
+    {
+        size_t i = find(c, from);
+        return i == npos ? -1 : (int)i;
+    }
+    int indexOf(const String &s, unsigned int from = 0) const
+    {
+        size_t i = find(s, from);
+        return i == npos ? -1 : (int)i;
+    }
+    int lastIndexOf(char c, unsigned int from) const
+    {
+        size_t i = rfind(c, from);
+        return i == npos ? -1 : (int)i;
+    }
+    String substring(unsigned int from) const { return from >= size() ? String() : String(substr(from)); }
+    String substring(unsigned int from, unsigned int to) const
+    {
+        if (from > to)
+        {
+            unsigned int t = from;
+            from = to;
+            to = t;
+        }
+        if (from >= size())
+        {
+            return String();
+        }
+        return String(substr(from, to - from));
+    }
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return atof(c_str()); }
+    void trim()
+    {
+        size_t begin = 0;
+        while (begin < size() && isspace((unsigned char)at(begin)))
+        {
+            begin++;
+        }
+        size_t end = size();
+        while (end > begin && isspace((unsigned char)at(end - 1)))
+        {
+            end--;
+        }
+        *this = String(substr(begin, end - begin));
+    }
+
+    String &operator+=(const String &s)
+    {
+        append(s);
+        return *this;
+    }
+    String &operator+=(const char *s)
+    {
+        append(s);
+        return *this;
+    }
+    String &operator+=(const __FlashStringHelper *s)
+    {
+        append(reinterpret_cast<const char *>(s));
+        return *this;
+    }
+    String &operator+=(char c)
+    {
+        push_back(c);
+        return *this;
+    }
+
+    static String fromInteger(long long value, unsigned char base)
+    {
+        char buffer[70];
+        if (base == 16)
+        {
+            snprintf(buffer, sizeof(buffer), "%llX", (unsigned long long)value);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), "%lld", value);
+        }
+        return String(buffer);
+    }
+    static String fromDouble(double value, unsigned int decimals)
+    {
+        if (isnan(value))
+        {
+            return String("nan");
+        }
+        if (isinf(value))
+        {
+            return String("inf");
+        }
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+        return String(buffer);
+    }
+};
+
+inline String operator+(const String &a, const String &b)
+{
+    return String(static_cast<const std::string &>(a) + static_cast<const std::string &>(b));
+}
+inline String operator+(const String &a, const char *b) { return String(static_cast<const std::string &>(a) + b); }
+inline String operator+(const char *a, const String &b) { return String(a + static_cast<const std::string &>(b)); }
+inline String operator+(const String &a, const __FlashStringHelper *b) { return a + String(b); }
+inline bool operator==(const String &a, const __FlashStringHelper *b) { return a == String(b); }
+inline bool operator!=(const String &a, const __FlashStringHelper *b) { return !(a == b); }
+
+class Print
+{
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+        size_t n = 0;
+        while (size--)
+        {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+    size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+    virtual void flush() {}
+
+    size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.size()); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(const __FlashStringHelper *s) { return write(reinterpret_cast<const char *>(s)); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print(String::fromInteger(value, base)); }
+    size_t print(int value, int base = DEC) { return print(String::fromInteger(value, base)); }
+    size_t print(unsigned int value, int base = DEC) { return print(String::fromInteger(value, base)); }
+    size_t print(long value, int base = DEC) { return print(String::fromInteger(value, base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String::fromInteger(value, base)); }
+    size_t print(long long value, int base = DEC) { return print(String::fromInteger(value, base)); }
+    size_t print(double value, int decimals = 2) { return print(String::fromDouble(value, decimals)); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(T value)
+    {
+        size_t n = print(value);
+        return n + println();
+    }
+    template <typename T>
+    size_t println(T value, int format)
+    {
+        size_t n = print(value, format);
+        return n + println();
+    }
+};
+
+class Stream : public Print
+{
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    String readStringUntil(char terminator);
+    String readString();
+    size_t readBytes(char *buffer, size_t length);
+    long parseInt();
+    float parseFloat();
+
+protected:
+    unsigned long _timeout = 1000;
+    int timedRead();
+    int timedPeek();
+};
+
+// ESP32 core UART error events, see HardwareSerial::onReceiveError()
+typedef enum
+{
+    UART_NO_ERROR,
+    UART_BREAK_ERROR,
+    UART_BUFFER_FULL_ERROR,
+    UART_FIFO_OVF_ERROR,
+    UART_FRAME_ERROR,
+    UART_PARITY_ERROR
+} hardwareSerial_error_t;
+typedef std::function<void(hardwareSerial_error_t)> OnReceiveErrorCb;
+
+// in-memory UART: the test feeds received bytes with hostReceive() and
+// collects what the sketch sent with hostTransmitted(). After
+// hostAttach() it is instead one end of a pseudo terminal: bytes leave
+// at baudRate() / 10 per second, and a byte sent while the other end
+// runs at another rate (hostPeerBaudRate) goes out with its top bit set;
+// the receiving UART reports such bytes as a framing error
+class HardwareSerial : public Stream
+{
+public:
+    void begin(unsigned long baud) { _baudRate = baud; }
+    void end() {}
+    void updateBaudRate(unsigned long baud) { _baudRate = baud; }
+    unsigned long baudRate() { return _baudRate; }
+    void onReceiveError(OnReceiveErrorCb function) { _onReceiveError = function; }
+
+    size_t write(uint8_t c);
+    using Print::write;
+    int available();
+    int read();
+    int peek();
+    void flush();
+
+    void hostReceive(const String &data);
+    String hostTransmitted();
+    void hostClear();
+    void hostAttach(int fd);
+    std::atomic<unsigned long> hostPeerBaudRate{9600};
+
+private:
+    std::atomic<unsigned long> _baudRate{9600};
+    OnReceiveErrorCb _onReceiveError;
+    std::string _received;
+    std::string _transmitted;
+    int _fd = -1;
+    std::chrono::steady_clock::time_point _nextByteTime;
+
+    void receiveFromPty();
+};
+
+// waits until the next byte has been shifted out at the given rate,
+// 10 bits per byte
+void hostPaceByte(std::chrono::steady_clock::time_point *nextByteTime, unsigned long baudRate);
+
+extern HardwareSerial Serial;
+
+// time: real time plus whatever delay() skipped, so DS18B20 and ADS1115
+// waits cost nothing on the host
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+// pins: the test sets what digitalRead() and analogRead() see
+extern int hostDigitalLevel[40];
+extern int (*hostAnalogRead)(uint8_t pin);
+void pinMode(uint8_t pin, uint8_t mode);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+// cycle counter of a 240 MHz core, derived from the host clock
+class EspClass
+{
+public:
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() { return 240; }
+};
+extern EspClass ESP;
+
+#endif
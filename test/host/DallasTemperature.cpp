@@ -0,0 +1,162 @@
+#include "DallasTemperature.h"
+
+void DallasTemperature::begin()
+{
+    DeviceAddress deviceAddress;
+    _devices = 0;
+    _parasite = false;
+    _wire->reset_search();
+    while (_wire->search(deviceAddress))
+    {
+        if (OneWire::crc8(deviceAddress, 7) == deviceAddress[7])
+        {
+            getResolution(deviceAddress); // the library tracks the highest resolution on the bus
+            _parasite = _parasite || readPowerSupply(deviceAddress);
+            _devices++;
+        }
+    }
+}
+
+bool DallasTemperature::getAddress(uint8_t *deviceAddress, uint8_t index)
+{
+    uint8_t depth = 0;
+    _wire->reset_search();
+    while ((depth <= index) && _wire->search(deviceAddress))
+    {
+        if ((depth == index) && (OneWire::crc8(deviceAddress, 7) == deviceAddress[7]))
+        {
+            return true;
+        }
+        depth++;
+    }
+    return false;
+}
+
+bool DallasTemperature::readScratchPad(const uint8_t *deviceAddress, uint8_t *scratchPad)
+{
+    if (_wire->reset() == 0)
+    {
+        return false;
+    }
+    _wire->select(deviceAddress);
+    _wire->write(READSCRATCH);
+    for (uint8_t i = 0; i < 9; i++)
+    {
+        scratchPad[i] = _wire->read();
+    }
+    return _wire->reset() == 1;
+}
+
+bool DallasTemperature::isConnected(const uint8_t *deviceAddress, uint8_t *scratchPad)
+{
+    if (!readScratchPad(deviceAddress, scratchPad))
+    {
+        return false;
+    }
+    bool isAllZeros = true;
+    for (int i = 0; i < 9; i++)
+    {
+        isAllZeros = isAllZeros && (scratchPad[i] == 0);
+    }
+    return !isAllZeros && (OneWire::crc8(scratchPad, 8) == scratchPad[8]);
+}
+
+// true when a probe (any probe, without an address) is parasite powered
+bool DallasTemperature::readPowerSupply(const uint8_t *deviceAddress)
+{
+    bool parasiteMode = false;
+    _wire->reset();
+    if (deviceAddress == nullptr)
+    {
+        _wire->skip();
+    }
+    else
+    {
+        _wire->select(deviceAddress);
+    }
+    _wire->write(READPOWERSUPPLY);
+    if (_wire->read_bit() == 0)
+    {
+        parasiteMode = true;
+    }
+    _wire->reset();
+    return parasiteMode;
+}
+
+uint8_t DallasTemperature::getResolution(const uint8_t *deviceAddress)
+{
+    uint8_t scratchPad[9];
+    if (!isConnected(deviceAddress, scratchPad))
+    {
+        return 0;
+    }
+    return 9 + ((scratchPad[4] >> 5) & 0x03);
+}
+
+bool DallasTemperature::setResolution(const uint8_t *deviceAddress, uint8_t newResolution, bool skipGlobalBitResolutionCalculation)
+{
+    uint8_t scratchPad[9];
+    if (!isConnected(deviceAddress, scratchPad))
+    {
+        return false;
+    }
+    uint8_t config = ((constrain(newResolution, 9, 12) - 9) << 5) | 0x1F;
+    if (scratchPad[4] != config)
+    {
+        _wire->reset();
+        _wire->select(deviceAddress);
+        _wire->write(0x4E);
+        _wire->write(scratchPad[2]);
+        _wire->write(scratchPad[3]);
+        _wire->write(config);
+        _wire->reset();
+        _wire->select(deviceAddress);
+        _wire->write(0x48); // copy scratchpad to EEPROM
+        delay(20);
+        _wire->reset();
+    }
+    return true;
+}
+
+bool DallasTemperature::requestTemperaturesByAddress(const uint8_t *deviceAddress)
+{
+    uint8_t bitResolution = getResolution(deviceAddress);
+    if (bitResolution == 0)
+    {
+        return false;
+    }
+    _wire->reset();
+    _wire->select(deviceAddress);
+    _wire->write(STARTCONVO, _parasite);
+    if (_waitForConversion)
+    {
+        delay(millisToWaitForConversion(bitResolution));
+    }
+    return true;
+}
+
+uint16_t DallasTemperature::millisToWaitForConversion(uint8_t bitResolution)
+{
+    switch (bitResolution)
+    {
+    case 9:
+        return 94;
+    case 10:
+        return 188;
+    case 11:
+        return 375;
+    default:
+        return 750;
+    }
+}
+
+float DallasTemperature::getTempC(const uint8_t *deviceAddress)
+{
+    uint8_t scratchPad[9];
+    if (!isConnected(deviceAddress, scratchPad))
+    {
+        return DEVICE_DISCONNECTED_C;
+    }
+    int16_t raw = (scratchPad[1] << 8) | scratchPad[0];
+    return raw * 0.0625f;
+}
@@ -0,0 +1,43 @@
+// host shim of the DallasTemperature library: the calls the sketch uses,
+// doing the same OneWire transactions as the library (3.9) does
+#ifndef _HOST_DALLASTEMPERATURE_H_
+#define _HOST_DALLASTEMPERATURE_H_
+
+#include <Arduino.h>
+#include <OneWire.h>
+
+#define DEVICE_DISCONNECTED_C -127
+
+#define STARTCONVO 0x44 // DS18B20 function commands, as the library defines them
+#define READSCRATCH 0xBE
+#define READPOWERSUPPLY 0xB4
+
+typedef uint8_t DeviceAddress[8];
+
+class DallasTemperature
+{
+public:
+    DallasTemperature(OneWire *wire) : _wire(wire) {}
+    void begin();
+    uint8_t getDeviceCount() { return _devices; }
+    bool getAddress(uint8_t *deviceAddress, uint8_t index);
+    uint8_t getResolution(const uint8_t *deviceAddress);
+    bool setResolution(const uint8_t *deviceAddress, uint8_t newResolution, bool skipGlobalBitResolutionCalculation = false);
+    void setWaitForConversion(bool flag) { _waitForConversion = flag; }
+    bool requestTemperaturesByAddress(const uint8_t *deviceAddress);
+    uint16_t millisToWaitForConversion(uint8_t bitResolution);
+    float getTempC(const uint8_t *deviceAddress);
+    bool isConnected(const uint8_t *deviceAddress, uint8_t *scratchPad);
+    bool readPowerSupply(const uint8_t *deviceAddress = nullptr);
+    bool isParasitePowerMode() { return _parasite; }
+
+private:
+    OneWire *_wire;
+    uint8_t _devices = 0;
+    bool _waitForConversion = true;
+    bool _parasite = false;
+
+    bool readScratchPad(const uint8_t *deviceAddress, uint8_t *scratchPad);
+};
+
+#endif
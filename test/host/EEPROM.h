@@ -0,0 +1,33 @@
+// host shim: emulated flash, erased (0xFF) at start like a new ESP32
+#ifndef _HOST_EEPROM_H_
+#define _HOST_EEPROM_H_
+
+#include <Arduino.h>
+
+class EEPROMClass
+{
+public:
+    EEPROMClass() { memset(_data, 0xFF, sizeof(_data)); }
+    bool begin(size_t size) { return size <= sizeof(_data); }
+    bool commit() { return true; }
+    uint8_t read(int address) { return _data[address]; }
+    void write(int address, uint8_t value) { _data[address] = value; }
+    float readFloat(int address)
+    {
+        float value;
+        memcpy(&value, _data + address, sizeof(value));
+        return value;
+    }
+    size_t writeFloat(int address, float value)
+    {
+        memcpy(_data + address, &value, sizeof(value));
+        return sizeof(value);
+    }
+
+private:
+    uint8_t _data[4096];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
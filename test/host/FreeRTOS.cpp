@@ -0,0 +1,94 @@
+#include "Arduino.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct HostQueue
+{
+    std::mutex mutex;
+    std::condition_variable received;
+    std::deque<std::string> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    HostQueue *queue = new HostQueue;
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+// never blocks on a full queue, the sketch only sends with no wait
+BaseType_t xQueueSend(QueueHandle_t handle, const void *item, TickType_t ticksToWait)
+{
+    HostQueue *queue = (HostQueue *)handle;
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->items.size() >= queue->length)
+    {
+        return pdFALSE;
+    }
+    queue->items.push_back(std::string((const char *)item, queue->itemSize));
+    queue->received.notify_one();
+    return pdTRUE;
+}
+
+// waits in real time, delay() elsewhere does not shorten it
+BaseType_t xQueueReceive(QueueHandle_t handle, void *item, TickType_t ticksToWait)
+{
+    HostQueue *queue = (HostQueue *)handle;
+    std::unique_lock<std::mutex> lock(queue->mutex);
+    if (!queue->received.wait_for(lock, std::chrono::milliseconds(ticksToWait),
+                                  [queue] { return !queue->items.empty(); }))
+    {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->itemSize);
+    queue->items.pop_front();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle)
+{
+    HostQueue *queue = (HostQueue *)handle;
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    return queue->items.size();
+}
+
+void vQueueDelete(QueueHandle_t handle)
+{
+    delete (HostQueue *)handle;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    std::thread(function, parameter).detach();
+    return pdTRUE;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+}
+
+TickType_t xTaskGetTickCount()
+{
+    return millis();
+}
+
+// like FreeRTOS, returns at once when the wake time already passed
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t increment)
+{
+    *previousWakeTime += increment;
+    TickType_t now = xTaskGetTickCount();
+    while ((int32_t)(*previousWakeTime - now) > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(*previousWakeTime - now));
+        now = xTaskGetTickCount();
+    }
+}
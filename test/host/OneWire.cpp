@@ -0,0 +1,194 @@
+#include "OneWire.h"
+
+HostProbe hostProbes[HOST_MAX_PROBES];
+int hostProbeCount = 0;
+HostOneWireCounters hostOneWire;
+
+static void updateCrc(HostProbe *probe)
+{
+    probe->scratchpad[8] = OneWire::crc8(probe->scratchpad, 8);
+}
+
+int hostAddProbe(float temperature, uint8_t resolution)
+{
+    HostProbe *probe = &hostProbes[hostProbeCount];
+    probe->rom[0] = 0x28; // DS18B20 family
+    for (int i = 1; i < 7; i++)
+    {
+        probe->rom[i] = 0x10 * hostProbeCount + i;
+    }
+    probe->rom[7] = OneWire::crc8(probe->rom, 7);
+    probe->temperature = temperature;
+    const uint8_t powerOn[8] = {0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10}; // 85 ^C
+    memcpy(probe->scratchpad, powerOn, 8);
+    probe->scratchpad[4] = ((resolution - 9) << 5) | 0x1F;
+    updateCrc(probe);
+    probe->isConnected = true;
+    probe->isCorrupt = false;
+    probe->isParasite = false;
+    return hostProbeCount++;
+}
+
+void hostClearOneWireCounters()
+{
+    memset(&hostOneWire, 0, sizeof(hostOneWire));
+}
+
+uint8_t OneWire::reset()
+{
+    hostOneWire.resets++;
+    _selected = -1;
+    _command = -1;
+    for (int i = 0; i < hostProbeCount; i++)
+    {
+        if (hostProbes[i].isConnected)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void OneWire::select(const uint8_t rom[8])
+{
+    hostOneWire.selects++;
+    _selected = -1;
+    for (int i = 0; i < hostProbeCount; i++)
+    {
+        if (hostProbes[i].isConnected && (memcmp(hostProbes[i].rom, rom, 8) == 0))
+        {
+            _selected = i;
+        }
+    }
+}
+
+void OneWire::skip()
+{
+    hostOneWire.skips++;
+    _selected = -2;
+}
+
+void OneWire::write(uint8_t value, uint8_t power)
+{
+    if (_command == 0x4E) // write scratchpad: TH, TL, configuration
+    {
+        if (_selected >= 0)
+        {
+            HostProbe *probe = &hostProbes[_selected];
+            probe->scratchpad[2 + _position] = (_position == 2) ? ((value & 0x60) | 0x1F) : value;
+            updateCrc(probe);
+        }
+        _position++;
+        return;
+    }
+    hostOneWire.commands[value]++;
+    hostOneWire.poweredWrites += (power != 0);
+    _command = value;
+    _position = 0;
+    if (value != 0x44)
+    {
+        return;
+    }
+    for (int i = 0; i < hostProbeCount; i++) // convert T
+    {
+        if (((_selected == i) || (_selected == -2)) && (!hostProbes[i].isParasite || power))
+        {
+            HostProbe *probe = &hostProbes[i];
+            int unusedBits = 3 - ((probe->scratchpad[4] >> 5) & 0x03);
+            int16_t raw = (int16_t)lroundf(probe->temperature * 16.0f) & ~((1 << unusedBits) - 1);
+            probe->scratchpad[0] = raw & 0xFF;
+            probe->scratchpad[1] = (raw >> 8) & 0xFF;
+            updateCrc(probe);
+        }
+    }
+}
+
+void OneWire::write_bytes(const uint8_t *buffer, uint16_t count, bool power)
+{
+    for (int i = 0; i < count; i++)
+    {
+        write(buffer[i], power);
+    }
+}
+
+uint8_t OneWire::read()
+{
+    hostOneWire.bytesRead++;
+    if ((_command != 0xBE) || (_selected < 0) || (_position >= 9))
+    {
+        return 0xFF; // nobody drives the bus, the pull-up reads as ones
+    }
+    uint8_t value = hostProbes[_selected].scratchpad[_position];
+    if (hostProbes[_selected].isCorrupt && (_position == 8))
+    {
+        value ^= 0x5A;
+    }
+    _position++;
+    return value;
+}
+
+// after read power supply (0xB4), a parasite powered probe pulls the bit low
+uint8_t OneWire::read_bit()
+{
+    if (_command != 0xB4)
+    {
+        return 1;
+    }
+    for (int i = 0; i < hostProbeCount; i++)
+    {
+        if (hostProbes[i].isConnected && hostProbes[i].isParasite && ((_selected == i) || (_selected == -2)))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void OneWire::read_bytes(uint8_t *buffer, uint16_t count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        buffer[i] = read();
+    }
+}
+
+void OneWire::reset_search()
+{
+    _searchIndex = 0;
+}
+
+bool OneWire::search(uint8_t *newAddr, bool search_mode)
+{
+    while (_searchIndex < hostProbeCount)
+    {
+        HostProbe *probe = &hostProbes[_searchIndex++];
+        if (probe->isConnected)
+        {
+            memcpy(newAddr, probe->rom, 8);
+            return true;
+        }
+    }
+    hostOneWire.searches++;
+    return false;
+}
+
+// Dallas/Maxim CRC-8, polynomial x^8 + x^5 + x^4 + 1
+uint8_t OneWire::crc8(const uint8_t *addr, uint8_t len)
+{
+    uint8_t crc = 0;
+    while (len--)
+    {
+        uint8_t inbyte = *addr++;
+        for (uint8_t i = 8; i; i--)
+        {
+            uint8_t mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix)
+            {
+                crc ^= 0x8C;
+            }
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
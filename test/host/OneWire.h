@@ -0,0 +1,62 @@
+// host shim: OneWire bus with simulated DS18B20 probes, counting every
+// bus transaction so the tests can check how the sketch uses the bus
+#ifndef _HOST_ONEWIRE_H_
+#define _HOST_ONEWIRE_H_
+
+#include <Arduino.h>
+
+#define HOST_MAX_PROBES 8
+
+struct HostProbe
+{
+    uint8_t rom[8];
+    float temperature;   // what the next conversion measures
+    uint8_t scratchpad[9];
+    bool isConnected;
+    bool isCorrupt;      // scratchpad reads with a bad CRC
+    bool isParasite;     // powered from the data line: converts only with the strong pull-up
+};
+
+struct HostOneWireCounters
+{
+    unsigned long resets;
+    unsigned long selects;
+    unsigned long skips;
+    unsigned long searches; // completed bus searches (a search ends when it finds no more probes)
+    unsigned long commands[256]; // function commands, e.g. 0x44 convert, 0xBE read scratchpad
+    unsigned long bytesRead;
+    unsigned long poweredWrites; // writes that left the strong pull-up on
+};
+
+extern HostProbe hostProbes[HOST_MAX_PROBES];
+extern int hostProbeCount;
+extern HostOneWireCounters hostOneWire;
+
+int hostAddProbe(float temperature, uint8_t resolution); // index of the new probe
+void hostClearOneWireCounters();
+
+class OneWire
+{
+public:
+    OneWire(uint8_t pin) {}
+    uint8_t reset(); // 1 if a probe answered with a presence pulse
+    void select(const uint8_t rom[8]);
+    void skip();
+    void write(uint8_t value, uint8_t power = 0);
+    void write_bytes(const uint8_t *buffer, uint16_t count, bool power = 0);
+    uint8_t read();
+    uint8_t read_bit();
+    void read_bytes(uint8_t *buffer, uint16_t count);
+    void depower() {}
+    void reset_search();
+    bool search(uint8_t *newAddr, bool search_mode = true);
+    static uint8_t crc8(const uint8_t *addr, uint8_t len);
+
+private:
+    int _selected = -1; // -1 none, -2 every probe (skip ROM)
+    int _command = -1;
+    int _position = 0;
+    int _searchIndex = 0;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include "Wire.h"
+
+TwoWire Wire;
+
+#define HOST_ADS_ADDRESS 0x48
+
+bool hostAdsIsConnected = true;
+float hostAdsMillivolts = 0;
+unsigned long hostAdsConversions = 0;
+
+int16_t hostAdsQuantize(float millivolts, float fullScaleMillivolts)
+{
+    float code = roundf(millivolts / fullScaleMillivolts * 32768.0f);
+    return constrain(code, -32768.0f, 32767.0f);
+}
+
+static int16_t convertHostAdsMillivolts(float fullScaleMillivolts)
+{
+    return hostAdsQuantize(hostAdsMillivolts, fullScaleMillivolts);
+}
+int16_t (*hostAdsConvert)(float fullScaleMillivolts) = convertHostAdsMillivolts;
+
+static uint8_t adsPointer;
+static uint16_t adsConfig = 0x8583; // power-on default
+static int16_t adsConversion;
+
+static float adsFullScale(uint16_t config)
+{
+    static const float fullScale[] = {6144, 4096, 2048, 1024, 512, 256, 256, 256};
+    return fullScale[(config >> 9) & 0x07];
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    _address = address;
+    _txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t value)
+{
+    if (_txLength >= sizeof(_txBuffer))
+    {
+        return 0;
+    }
+    _txBuffer[_txLength++] = value;
+    return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop)
+{
+    if ((_address != HOST_ADS_ADDRESS) || !hostAdsIsConnected)
+    {
+        return 2;
+    }
+    if (_txLength >= 1)
+    {
+        adsPointer = _txBuffer[0] & 0x03;
+    }
+    if ((_txLength == 3) && (adsPointer == 1))
+    {
+        adsConfig = (_txBuffer[1] << 8) | _txBuffer[2];
+        if (adsConfig & 0x8000) // start a single conversion
+        {
+            adsConversion = hostAdsConvert(adsFullScale(adsConfig));
+            hostAdsConversions++;
+        }
+    }
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity)
+{
+    _rxLength = 0;
+    _rxPosition = 0;
+    if ((address != HOST_ADS_ADDRESS) || !hostAdsIsConnected)
+    {
+        return 0;
+    }
+    uint16_t value = (adsPointer == 0) ? (uint16_t)adsConversion : adsConfig;
+    for (int i = 0; (i < quantity) && (i < (int)sizeof(_rxBuffer)); i++)
+    {
+        _rxBuffer[_rxLength++] = (i == 0) ? (value >> 8) : (i == 1) ? (value & 0xFF) : 0;
+    }
+    return _rxLength;
+}
+
+int TwoWire::available()
+{
+    return _rxLength - _rxPosition;
+}
+
+int TwoWire::read()
+{
+    if (_rxPosition >= _rxLength)
+    {
+        return -1;
+    }
+    return _rxBuffer[_rxPosition++];
+}
@@ -0,0 +1,37 @@
+// host shim: I2C bus with a simulated ADS1115 at 0x48
+#ifndef _HOST_WIRE_H_
+#define _HOST_WIRE_H_
+
+#include <Arduino.h>
+
+class TwoWire
+{
+public:
+    bool begin() { return true; }
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t value);
+    uint8_t endTransmission(bool sendStop = true); // 0 ok, 2 address not acknowledged
+    uint8_t requestFrom(uint8_t address, uint8_t quantity); // bytes received
+    int available();
+    int read(); // -1 when nothing was received
+
+private:
+    uint8_t _address;
+    uint8_t _txBuffer[8];
+    uint8_t _txLength;
+    uint8_t _rxBuffer[8];
+    uint8_t _rxLength;
+    uint8_t _rxPosition;
+};
+
+extern TwoWire Wire;
+
+// simulated ADS1115: conversions are taken on the config write with OS set,
+// hostAdsConvert() gives the code of AIN0 for the programmed full scale
+extern bool hostAdsIsConnected;
+extern float hostAdsMillivolts;
+extern int16_t (*hostAdsConvert)(float fullScaleMillivolts);
+extern unsigned long hostAdsConversions;
+int16_t hostAdsQuantize(float millivolts, float fullScaleMillivolts);
+
+#endif
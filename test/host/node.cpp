@@ -0,0 +1,11 @@
+// the globals the sketch defines and the sensor classes use
+#include "ESP_Sensor.h"
+
+Adafruit_SH1106G display(128, 64, &Wire, -1);
+debounceButton cal_button(14);
+debounceButton mode_button(27);
+OneWire oneWire(ONE_WIRE_BUS);
+DallasTemperature tempSensor(&oneWire);
+ESP_TempProbes tempProbes(&oneWire, &tempSensor);
+ESP_Trace trace;
+ESP_Profiler profiler;
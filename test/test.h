@@ -0,0 +1,45 @@
+// minimal assertion helpers shared by the host tests
+#ifndef _TEST_H_
+#define _TEST_H_
+
+#include <stdio.h>
+#include <math.h>
+#include <chrono>
+
+static int testFailures = 0;
+
+#define CHECK(condition)                                                      \
+    do                                                                        \
+    {                                                                         \
+        if (!(condition))                                                     \
+        {                                                                     \
+            printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            testFailures++;                                                   \
+        }                                                                     \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                        \
+    do                                                                                 \
+    {                                                                                  \
+        double a_ = (actual), e_ = (expected);                                         \
+        if (!(fabs(a_ - e_) <= (tolerance)) && !(isnan(a_) && isnan(e_)))              \
+        {                                                                              \
+            printf("%s:%d: CHECK_NEAR failed: %s = %.6g, expected %.6g (+-%.3g)\n",    \
+                   __FILE__, __LINE__, #actual, a_, e_, (double)(tolerance));          \
+            testFailures++;                                                            \
+        }                                                                              \
+    } while (0)
+
+// wall-clock seconds, for the throughput figures
+static inline double hostSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline int testResult(const char *name)
+{
+    printf("%s: %s\n", name, testFailures == 0 ? "PASS" : "FAIL");
+    return testFailures == 0 ? 0 : 1;
+}
+
+#endif
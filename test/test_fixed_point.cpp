@@ -0,0 +1,218 @@
+// float and Q16.16 sample conversion against the original double
+// formulas, over every raw code at every ADS1115 gain, plus the cost
+// per sample. The host has a double FPU, so the timings show the
+// relative cost of the integer path, not the ESP32's emulated doubles.
+#include "ESP_EC.h"
+#include "ESP_PH.h"
+#include "test.h"
+
+#include <random>
+
+// reach the protected conversion hooks through the base class
+struct SensorAccess : ESP_Sensor
+{
+    using ESP_Sensor::_coarseMaxRaw;
+    using ESP_Sensor::_temperature;
+    using ESP_Sensor::_voltage;
+    using ESP_Sensor::compensateVoltWithTemperature;
+    using ESP_Sensor::convertRawToVolt;
+    using ESP_Sensor::convertRawToVoltQ16;
+    using ESP_Sensor::resetRange;
+    using ESP_Sensor::selectRange;
+};
+
+extern Adafruit_ADS1115 ads;
+
+static float toVolt(ESP_Sensor *s, int raw)
+{
+    return (s->*(&SensorAccess::convertRawToVolt))(raw);
+}
+
+static int32_t toVoltQ16(ESP_Sensor *s, int raw)
+{
+    return (s->*(&SensorAccess::convertRawToVoltQ16))(raw);
+}
+
+// the ADS1115 board correction as it was, in double with pow(), with the
+// mean offset of the original truncation
+static double ecReference(int raw, double countScale)
+{
+    double adsvoltage = raw * countScale / 10.0 - ADS_TRUNCATION_OFFSET;
+    return 0.0000022091 * pow(adsvoltage, 3.0) - 0.00243269 * pow(adsvoltage, 2.0) + 1.74097 * adsvoltage - 8.11739;
+}
+
+static double adcReference(int raw)
+{
+    return (raw / 4095.0) * 3300;
+}
+
+static double gainFullScaleOf(adsGain_t gain)
+{
+    switch (gain)
+    {
+    case GAIN_SIXTEEN:
+        return 256;
+    case GAIN_EIGHT:
+        return 512;
+    case GAIN_FOUR:
+        return 1024;
+    case GAIN_TWO:
+        return 2048;
+    default:
+        return 4096;
+    }
+}
+
+// the EC range for a pre-burst peak of peakMillivolts
+static void selectEcRange(ESP_Sensor *ec, float peakMillivolts)
+{
+    (ec->*(&SensorAccess::resetRange))();
+    ec->*(&SensorAccess::_coarseMaxRaw) = peakMillivolts / 0.125f;
+    (ec->*(&SensorAccess::selectRange))();
+}
+
+static void checkEcConversion(ESP_Sensor *ec)
+{
+    const float peaks[] = {100, 300, 700, 1500, 3500}; // one per gain, narrowest first
+    for (float peak : peaks)
+    {
+        selectEcRange(ec, peak);
+        double countScale = gainFullScaleOf(ads.getGain()) / 4096.0;
+        // one code of this gain after the correction polynomial, ~1.74 mV per GAIN_ONE count / 10
+        double lsb = 1.74 * 0.125 * countScale;
+        double floatError = 0;
+        double q16Error = 0;
+        bool isSaturatedCorrectly = true;
+        for (int raw = 0; raw <= 32767; raw++)
+        {
+            double reference = ecReference(raw, countScale);
+            floatError = fmax(floatError, fabs(toVolt(ec, raw) - reference));
+            if (reference < 32767) // Q16.16 in an int32 ends there
+            {
+                q16Error = fmax(q16Error, fabs(toVoltQ16(ec, raw) / 65536.0 - reference));
+            }
+            else // saturated, or within rounding of it at the edge
+            {
+                isSaturatedCorrectly = isSaturatedCorrectly && (toVoltQ16(ec, raw) / 65536.0 > 32767 - lsb / 4);
+            }
+        }
+        printf("EC at %4.0f mV full scale: max error %.5f mV float, %.5f mV Q16 (1 code = %.4f mV)\n",
+               gainFullScaleOf(ads.getGain()), floatError, q16Error, lsb);
+        CHECK(floatError < lsb / 4);
+        CHECK(q16Error < lsb / 4);
+        CHECK(isSaturatedCorrectly);
+    }
+}
+
+static void checkAdcConversion(ESP_Sensor *ph)
+{
+    (ph->*(&SensorAccess::resetRange))();
+    double floatError = 0;
+    double q16Error = 0;
+    for (int raw = 0; raw <= 4095; raw++)
+    {
+        floatError = fmax(floatError, fabs(toVolt(ph, raw) - adcReference(raw)));
+        q16Error = fmax(q16Error, fabs(toVoltQ16(ph, raw) / 65536.0 - adcReference(raw)));
+    }
+    double lsb = 3300.0 / 4095;
+    printf("ESP32 ADC: max error %.5f mV float, %.5f mV Q16 (1 code = %.4f mV)\n", floatError, q16Error, lsb);
+    CHECK(floatError < lsb / 100);
+    CHECK(q16Error < lsb / 20);
+}
+
+// a whole burst average, as readAndAverageVolt() accumulates it
+static void checkBurstAverage(ESP_Sensor *ec)
+{
+    selectEcRange(ec, 3500);
+    std::mt19937 random(3);
+    std::normal_distribution<double> noise(0, 40);
+    double worstFloat = 0;
+    double worstQ16 = 0;
+    for (int burst = 0; burst < 200; burst++)
+    {
+        int center = 2000 + burst * 100; // up to ~2.7 V in, below the Q16 limit
+        double reference = 0;
+        float sumFloat = 0;
+        int64_t sumQ16 = 0;
+        for (int i = 0; i < BURST_SAMPLE_COUNT; i++)
+        {
+            int raw = constrain((int)(center + noise(random)), 0, 32767);
+            reference += ecReference(raw, 1.0);
+            sumFloat += toVolt(ec, raw);
+            sumQ16 += toVoltQ16(ec, raw);
+        }
+        reference /= BURST_SAMPLE_COUNT;
+        worstFloat = fmax(worstFloat, fabs(sumFloat / BURST_SAMPLE_COUNT - reference));
+        worstQ16 = fmax(worstQ16, fabs((float)sumQ16 / (BURST_SAMPLE_COUNT * 65536.0f) - reference));
+    }
+    printf("EC burst of %d: max error of the mean %.5f mV float, %.5f mV Q16\n", BURST_SAMPLE_COUNT, worstFloat,
+           worstQ16);
+    CHECK(worstFloat < 0.05);
+    CHECK(worstQ16 < 0.05);
+}
+
+// the float temperature compensations against their double originals
+static void checkCompensation(ESP_Sensor *ec, ESP_Sensor *ph)
+{
+    double ecError = 0;
+    double phError = 0;
+    for (float temperature = 0; temperature <= 50; temperature += 0.5f)
+    {
+        for (float voltage = 0; voltage <= 3300; voltage += 10)
+        {
+            ec->*(&SensorAccess::_voltage) = voltage;
+            ec->*(&SensorAccess::_temperature) = temperature;
+            ph->*(&SensorAccess::_voltage) = voltage;
+            ph->*(&SensorAccess::_temperature) = temperature;
+            double ecReference = voltage / (1.0 + 0.0185 * (temperature - 25.0));
+            double phReference = 1500 + (voltage - 1500) * (298.15 / (temperature + 273.15));
+            ecError = fmax(ecError, fabs((ec->*(&SensorAccess::compensateVoltWithTemperature))() - ecReference));
+            phError = fmax(phError, fabs((ph->*(&SensorAccess::compensateVoltWithTemperature))() - phReference));
+        }
+    }
+    printf("temperature compensation: max error %.5f mV EC, %.5f mV pH\n", ecError, phError);
+    CHECK(ecError < 0.001);
+    CHECK(phError < 0.001);
+}
+
+// ns per converted sample for each path
+template <typename Convert>
+static double measure(Convert convert)
+{
+    const int samples = 5000000;
+    double start = hostSeconds();
+    double sum = 0;
+    for (int i = 0; i < samples; i++)
+    {
+        sum += convert(i & 32767);
+    }
+    volatile double sink = sum;
+    (void)sink;
+    return (hostSeconds() - start) / samples * 1e9;
+}
+
+static void measureCost(ESP_Sensor *ec, ESP_Sensor *ph)
+{
+    selectEcRange(ec, 3500);
+    double ecDouble = measure([](int raw) { return ecReference(raw, 1.0); });
+    double ecFloat = measure([ec](int raw) { return toVolt(ec, raw); });
+    double ecQ16 = measure([ec](int raw) { return toVoltQ16(ec, raw); });
+    double adcDouble = measure([](int raw) { return adcReference(raw & 4095); });
+    double adcFloat = measure([ph](int raw) { return toVolt(ph, raw & 4095); });
+    double adcQ16 = measure([ph](int raw) { return toVoltQ16(ph, raw & 4095); });
+    printf("per sample (host): EC %.1f ns double pow(), %.1f ns float, %.1f ns Q16; "
+           "ADC %.1f ns double, %.1f ns float, %.1f ns Q16\n",
+           ecDouble, ecFloat, ecQ16, adcDouble, adcFloat, adcQ16);
+}
+
+int main()
+{
+    ESP_EC ec;
+    ESP_PH ph;
+    checkEcConversion(&ec);
+    checkAdcConversion(&ph);
+    checkBurstAverage(&ec);
+    checkCompensation(&ec, &ph);
+    measureCost(&ec, &ph);
+    return testResult("test_fixed_point");
+}
@@ -0,0 +1,297 @@
+// health checks of a measurement: each pre-burst and temperature rule,
+// synthetic fault traces replayed through a sensor, the temperature
+// check on every burst's reading, only for the sensors with
+// temperature compensation, failed or negative ADS1115 reads, and the
+// same faults while streaming
+#include "ESP_EC.h"
+#include "ESP_NH3N.h"
+#include "ESP_PH.h"
+#include "test.h"
+
+// reach the protected raw read through the base class
+struct SensorAccess : ESP_Sensor
+{
+    using ESP_Sensor::_burstSampleCount;
+    using ESP_Sensor::_coarseMaxRaw;
+    using ESP_Sensor::readRawSample;
+    using ESP_Sensor::resetRange;
+    using ESP_Sensor::selectRange;
+};
+
+extern ESP_TempProbes tempProbes;
+extern ESP_Profiler profiler;
+extern ESP_Trace trace;
+
+struct SampleCase
+{
+    const char *name;
+    int raw[HEALTH_SAMPLE_COUNT];
+    byte count;
+    int fullScale;
+    byte status;
+};
+
+static void checkSampleRules()
+{
+    const SampleCase cases[] = {
+        {"noisy", {2000, 2003, 1998, 2001, 2000, 2002, 1999, 2000, 2004, 1997}, 10, 4095, STATUS_OK},
+        {"top rail", {4095, 4095, 4095, 4095, 4095, 4095, 4095, 4095, 4095, 4095}, 10, 4095, STATUS_SATURATED},
+        {"ADS1115 top rail", {32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767, 32767}, 10, 32767,
+         STATUS_SATURATED},
+        {"one below the rail", {4095, 4095, 4095, 4094, 4095, 4095, 4095, 4095, 4095, 4095}, 10, 4095, STATUS_OK},
+        {"zero", {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, 10, 4095, STATUS_OPEN_CIRCUIT},
+        {"zero with a spike", {0, 0, 0, 0, 12, 0, 0, 0, 0, 0}, 10, 4095, STATUS_OK},
+        {"stuck", {1234, 1234, 1234, 1234, 1234, 1234, 1234, 1234, 1234, 1234}, 10, 4095, STATUS_STUCK},
+        {"failed read", {2000, 2003, 1998, RAW_READ_ERROR}, 4, 32767, STATUS_I2C_ERROR},
+        {"failed read first", {RAW_READ_ERROR}, 1, 32767, STATUS_I2C_ERROR},
+        {"failed read at the rail", {32767, 32767, RAW_READ_ERROR}, 3, 32767, STATUS_I2C_ERROR},
+    };
+    for (const SampleCase &c : cases)
+    {
+        byte status = ESP_Sensor::classifySamples(c.raw, c.count, c.fullScale);
+        if (status != c.status)
+        {
+            printf("%s: status %d, expected %d\n", c.name, status, c.status);
+        }
+        CHECK(status == c.status);
+    }
+}
+
+static void checkTemperatureRules()
+{
+    CHECK(ESP_Sensor::classifyTemperature(24.0f) == STATUS_OK);
+    CHECK(ESP_Sensor::classifyTemperature(TEMP_PLAUSIBLE_MIN) == STATUS_OK);
+    CHECK(ESP_Sensor::classifyTemperature(TEMP_PLAUSIBLE_MAX) == STATUS_OK);
+    CHECK(ESP_Sensor::classifyTemperature(TEMP_PLAUSIBLE_MIN - 0.1f) == STATUS_BAD_TEMPERATURE);
+    CHECK(ESP_Sensor::classifyTemperature(TEMP_PLAUSIBLE_MAX + 0.1f) == STATUS_BAD_TEMPERATURE);
+    CHECK(ESP_Sensor::classifyTemperature(DEVICE_DISCONNECTED_C) == STATUS_BAD_TEMPERATURE);
+    CHECK(ESP_Sensor::classifyTemperature(TEMP_POWER_ON_VALUE) == STATUS_BAD_TEMPERATURE);
+    CHECK(ESP_Sensor::classifyTemperature(NAN) == STATUS_BAD_TEMPERATURE);
+}
+
+// a measurement as the sensor would have recorded it: the pre-burst,
+// then bursts of burstRaw, each followed by its temperature
+static void recordMeasurement(ESP_Sensor *sensor, const int *preBurst, byte count, int burstRaw,
+                              const float *temperatures, int burstCount)
+{
+    int peak = 0;
+    for (int i = 0; i < count; i++)
+    {
+        peak = (preBurst[i] > peak) ? preBurst[i] : peak;
+    }
+    (sensor->*(&SensorAccess::resetRange))();
+    sensor->*(&SensorAccess::_coarseMaxRaw) = peak;
+    (sensor->*(&SensorAccess::selectRange))();
+    int samplesPerBurst = sensor->*(&SensorAccess::_burstSampleCount);
+    trace.startRecording();
+    for (int i = 0; i < count; i++)
+    {
+        trace.recordSample(preBurst[i]);
+    }
+    for (int burst = 0; burst < burstCount; burst++)
+    {
+        trace.recordBurst();
+        for (int i = 0; i < samplesPerBurst; i++)
+        {
+            trace.recordSample(burstRaw + (i & 3));
+        }
+        trace.recordTemperature(temperatures[burst]);
+    }
+    trace.stop();
+}
+
+static byte replayMeasurement(ESP_Sensor *sensor)
+{
+    trace.startReplay();
+    sensor->updateVoltAndValue();
+    trace.stop();
+    CHECK(!trace.isError());
+    return sensor->_status;
+}
+
+// synthetic faults, replayed through the unmodified pH measurement
+static void checkFaultTraces(ESP_Sensor *ph)
+{
+    const int noisy[HEALTH_SAMPLE_COUNT] = {2000, 2003, 1998, 2001, 2000, 2002, 1999, 2000, 2004, 1997};
+    const int saturated[HEALTH_SAMPLE_COUNT] = {4095, 4095, 4095, 4095, 4095, 4095, 4095, 4095, 4095, 4095};
+    const int unplugged[HEALTH_SAMPLE_COUNT] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    const int stuck[HEALTH_SAMPLE_COUNT] = {1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500, 1500};
+    const int failing[] = {2000, 2003, RAW_READ_ERROR}; // the pre-burst stops at the failed read
+    const float good[] = {24.0f, 24.0f, 24.0f, 24.0f, 24.0f};
+    const float powerOn[] = {TEMP_POWER_ON_VALUE};
+    const float missing[] = {DEVICE_DISCONNECTED_C};
+    const float droppedOut[] = {24.0f, 24.0f, DEVICE_DISCONNECTED_C}; // lost during the third burst
+    const float latePowerOn[] = {24.0f, 24.0f, 24.0f, 24.0f, TEMP_POWER_ON_VALUE};
+
+    recordMeasurement(ph, noisy, HEALTH_SAMPLE_COUNT, 2000, good, 5);
+    CHECK(replayMeasurement(ph) == STATUS_OK);
+    CHECK(!isnan(ph->_value));
+    recordMeasurement(ph, saturated, HEALTH_SAMPLE_COUNT, 0, good, 0);
+    CHECK(replayMeasurement(ph) == STATUS_SATURATED);
+    recordMeasurement(ph, unplugged, HEALTH_SAMPLE_COUNT, 0, good, 0);
+    CHECK(replayMeasurement(ph) == STATUS_OPEN_CIRCUIT);
+    recordMeasurement(ph, stuck, HEALTH_SAMPLE_COUNT, 0, good, 0);
+    CHECK(replayMeasurement(ph) == STATUS_STUCK);
+    recordMeasurement(ph, failing, 3, 0, good, 0);
+    CHECK(replayMeasurement(ph) == STATUS_I2C_ERROR);
+    recordMeasurement(ph, noisy, HEALTH_SAMPLE_COUNT, 2000, powerOn, 1);
+    CHECK(replayMeasurement(ph) == STATUS_BAD_TEMPERATURE);
+    recordMeasurement(ph, noisy, HEALTH_SAMPLE_COUNT, 2000, missing, 1);
+    CHECK(replayMeasurement(ph) == STATUS_BAD_TEMPERATURE);
+    CHECK(isnan(ph->_value));
+    recordMeasurement(ph, noisy, HEALTH_SAMPLE_COUNT, 2000, droppedOut, 3);
+    CHECK(replayMeasurement(ph) == STATUS_BAD_TEMPERATURE);
+    CHECK(isnan(ph->_value));
+    recordMeasurement(ph, noisy, HEALTH_SAMPLE_COUNT, 2000, latePowerOn, 5);
+    CHECK(replayMeasurement(ph) == STATUS_BAD_TEMPERATURE);
+    CHECK(isnan(ph->_value));
+}
+
+static int noisyInput(uint8_t pin)
+{
+    return 2000 + (micros() & 7);
+}
+
+// one conversion per burst, the first one doubling as the probe check
+static void checkTemperatureReads(ESP_Sensor *ph, ESP_Sensor *nh3n)
+{
+    hostClearOneWireCounters();
+    ph->updateVoltAndValue();
+    CHECK(ph->_status == STATUS_OK);
+    CHECK(hostOneWire.commands[STARTCONVO] == 5);
+    CHECK_NEAR(ph->_temperature, 24.0, 0.001);
+
+    hostClearOneWireCounters();
+    nh3n->updateVoltAndValue();
+    CHECK(nh3n->_status == STATUS_OK);
+    CHECK(hostOneWire.commands[STARTCONVO] == 0); // no compensation, no conversion
+    CHECK(isnan(nh3n->_temperature));
+}
+
+// a bad probe aborts at the first burst already, and only where it is used
+static void checkBadTemperature(ESP_Sensor *ph, ESP_Sensor *nh3n)
+{
+    const float badTemperatures[] = {TEMP_POWER_ON_VALUE, TEMP_PLAUSIBLE_MIN - 1, TEMP_PLAUSIBLE_MAX + 1};
+    for (float temperature : badTemperatures)
+    {
+        hostProbes[0].temperature = temperature;
+        hostClearOneWireCounters();
+        ph->updateVoltAndValue();
+        CHECK(ph->_status == STATUS_BAD_TEMPERATURE);
+        CHECK(isnan(ph->_value));
+        CHECK(hostOneWire.commands[STARTCONVO] == 1);
+        nh3n->updateVoltAndValue();
+        CHECK(nh3n->_status == STATUS_OK);
+    }
+
+    hostProbes[0].isConnected = false;
+    ph->updateVoltAndValue();
+    CHECK(ph->_status == STATUS_BAD_TEMPERATURE);
+    CHECK(ph->_temperature == DEVICE_DISCONNECTED_C);
+    hostProbes[0].isConnected = true;
+    hostProbes[0].temperature = 24.0f;
+}
+
+static int16_t noisyAds(float fullScaleMillivolts)
+{
+    return hostAdsQuantize(hostAdsMillivolts + (micros() & 7), fullScaleMillivolts);
+}
+
+static long i2cErrorCount()
+{
+    Serial.hostClear();
+    profiler.report(&Serial);
+    String report = Serial.hostTransmitted();
+    return report.substring(report.indexOf(";I2CError:") + 10).toInt();
+}
+
+// a failed I2C transaction is an error, a conversion of -1 count (0xFFFF,
+// what the library also returns for a failed read) is a clamped 0
+static void checkAdsReads(ESP_Sensor *ec)
+{
+    profiler.reset();
+    hostAdsMillivolts = -0.125f; // -1 count at GAIN_ONE
+    CHECK((ec->*(&SensorAccess::readRawSample))() == 0);
+    hostAdsMillivolts = -100;
+    CHECK((ec->*(&SensorAccess::readRawSample))() == 0);
+    CHECK(i2cErrorCount() == 0);
+    ec->updateVoltAndValue();
+    CHECK(ec->_status == STATUS_OPEN_CIRCUIT);
+
+    hostAdsIsConnected = false;
+    CHECK((ec->*(&SensorAccess::readRawSample))() == RAW_READ_ERROR);
+    CHECK(i2cErrorCount() == 1);
+    ec->updateVoltAndValue();
+    CHECK(ec->_status == STATUS_I2C_ERROR);
+    CHECK(isnan(ec->_value));
+    hostAdsIsConnected = true;
+
+    hostAdsConvert = noisyAds;
+    hostAdsMillivolts = 1000;
+    ec->updateVoltAndValue();
+    CHECK(ec->_status == STATUS_OK);
+    CHECK(ec->_value > 0);
+}
+
+// a failed read holds the filtered value and shows as its raw code; a bad
+// temperature at the start of a stream is not used for any of it
+static void checkStreamSamples(ESP_Sensor *ec, ESP_Sensor *nh3n)
+{
+    hostAdsMillivolts = 1000;
+    ec->startStream();
+    int raw;
+    float value = NAN;
+    for (int i = 0; i < 20; i++)
+    {
+        value = ec->readStreamSample(&raw);
+    }
+    CHECK(value > 0);
+    hostAdsIsConnected = false;
+    CHECK(ec->readStreamSample(&raw) == value);
+    CHECK(raw == RAW_READ_ERROR);
+    CHECK(ec->readStreamSample(&raw) == value);
+    hostAdsIsConnected = true;
+    CHECK_NEAR(ec->readStreamSample(&raw), value, value * 0.01);
+    CHECK(raw > 0);
+
+    hostAdsIsConnected = false; // no good sample yet
+    ec->startStream();
+    CHECK(isnan(ec->readStreamSample(&raw)));
+    hostAdsIsConnected = true;
+    CHECK(ec->readStreamSample(&raw) > 0);
+
+    hostProbes[0].isConnected = false;
+    ec->startStream();
+    nh3n->startStream();
+    CHECK(isnan(ec->_temperature));
+    CHECK(isnan(ec->readStreamSample(&raw)));
+    CHECK(raw > 0);
+    CHECK(!isnan(nh3n->readStreamSample(&raw))); // no compensation, no probe needed
+    hostProbes[0].isConnected = true;
+}
+
+int main()
+{
+    hostAnalogRead = noisyInput;
+    hostAddProbe(24.0f, 9);
+    EEPROM.write(TEMP_PROBE_EEPROM_ADDRESS, 0xFF); // no stored probes: search the bus
+    tempProbes.begin();
+    ESP_EC ec;
+    ESP_PH ph;
+    ESP_NH3N nh3n;
+    ec.begin();
+    ph.begin();
+    nh3n.begin();
+    ec._enableSensor = true;
+    ph._enableSensor = true;
+    nh3n._enableSensor = true;
+
+    checkSampleRules();
+    checkTemperatureRules();
+    checkFaultTraces(&ph);
+    checkTemperatureReads(&ph, &nh3n);
+    checkBadTemperature(&ph, &nh3n);
+    checkAdsReads(&ec);
+    checkStreamSamples(&ec, &nh3n);
+    return testResult("test_health");
+}
@@ -0,0 +1,298 @@
+// ESP_Link over a pseudo terminal: the node's Serial on one end and a
+// simulated Sink Node on the other, both paced at their baud rate.
+// Bytes sent while the two ends run at different rates arrive garbled
+// and raise UART_FRAME_ERROR on the node, see HardwareSerial in host/
+#include "ESP_Link.h"
+#include "test.h"
+
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+#include <thread>
+
+#define REPORT_LINE "Data#12:00;EC:1.234;Tbd:123.4;PH:7.01;NH3N:20.1;" // 48 bytes with CR LF
+
+static ESP_Link sinkLink(&Serial);
+
+// the Sink Node's end of the pseudo terminal
+class Sink
+{
+public:
+    int fd;
+
+    void setBaudRate(unsigned long baudRate)
+    {
+        _baudRate = baudRate;
+        Serial.hostPeerBaudRate = baudRate;
+    }
+
+    // noise flips the top bit of one byte, as a corrupted stop bit would
+    void send(const String &line, int noiseAt = -1)
+    {
+        String bytes = line + "\n";
+        for (unsigned int i = 0; i < bytes.length(); i++)
+        {
+            hostPaceByte(&_nextByteTime, _baudRate);
+            uint8_t c = bytes[i];
+            if ((Serial.baudRate() != _baudRate) || ((int)i == noiseAt))
+            {
+                c |= 0x80;
+            }
+            CHECK(::write(fd, &c, 1) == 1);
+        }
+    }
+
+    // the next line without its CR, false on timeout
+    bool readLine(String *line, int timeoutMs)
+    {
+        double deadline = hostSeconds() + timeoutMs / 1000.0;
+        while (true)
+        {
+            size_t end = _received.find('\n');
+            if (end != std::string::npos)
+            {
+                *line = String(_received.substr(0, end));
+                _received.erase(0, end + 1);
+                if (line->endsWith("\r"))
+                {
+                    *line = line->substring(0, line->length() - 1);
+                }
+                return true;
+            }
+            double remaining = deadline - hostSeconds();
+            if (remaining <= 0)
+            {
+                return false;
+            }
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (poll(&pfd, 1, (int)(remaining * 1000) + 1) > 0)
+            {
+                char buffer[256];
+                ssize_t count = ::read(fd, buffer, sizeof(buffer));
+                if (count > 0)
+                {
+                    _received.append(buffer, count);
+                }
+            }
+        }
+    }
+
+    // skips other lines; a line sent at the other rate has no readable
+    // '\n' and runs into the next one, so only the end has to match
+    bool waitFor(const String &expected, int timeoutMs)
+    {
+        double deadline = hostSeconds() + timeoutMs / 1000.0;
+        String line;
+        while (readLine(&line, (int)((deadline - hostSeconds()) * 1000)))
+        {
+            if (line.endsWith(expected))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // bytes per second of lineCount report lines, from the end of the
+    // first to the end of the last; all must arrive intact
+    double measureThroughput(int lineCount)
+    {
+        String line;
+        int intactCount = 0;
+        double start = 0;
+        for (int i = 0; (i < lineCount) && readLine(&line, 5000); i++)
+        {
+            if (i == 0)
+            {
+                start = hostSeconds();
+            }
+            intactCount += (line == REPORT_LINE);
+        }
+        CHECK(intactCount == lineCount);
+        return (lineCount - 1) * (strlen(REPORT_LINE) + 2) / (hostSeconds() - start);
+    }
+
+private:
+    unsigned long _baudRate = BASE_BAUD_RATE;
+    std::chrono::steady_clock::time_point _nextByteTime;
+    std::string _received;
+};
+
+static Sink sink;
+
+static void sendReportLines(int lineCount)
+{
+    for (int i = 0; i < lineCount; i++)
+    {
+        Serial.println(REPORT_LINE);
+    }
+}
+
+// the node waits for a command, as setup() does
+static String nodeCommand()
+{
+    return sinkLink.readCommand();
+}
+
+// node side keeps checking the link, as dataRequestResponse() and the
+// stream do, until it fell back or the time is up
+static bool nodeWaitsForFallback(int timeoutMs)
+{
+    double deadline = hostSeconds() + timeoutMs / 1000.0;
+    while ((sinkLink.baudRate() != BASE_BAUD_RATE) && (hostSeconds() < deadline))
+    {
+        sinkLink.checkErrors();
+    }
+    return sinkLink.baudRate() == BASE_BAUD_RATE;
+}
+
+static void negotiate(unsigned long baudRate)
+{
+    std::thread sinkThread([baudRate] {
+        sink.send("baud:" + String(baudRate));
+        CHECK(sink.waitFor("baudok:" + String(baudRate), 2000));
+        sink.setBaudRate(baudRate);
+        usleep(10000); // as a real sink, give the node time to switch
+        sink.send("baudcheck");
+        CHECK(sink.waitFor("baudconfirmed", 2000));
+    });
+    String command = nodeCommand();
+    CHECK(command == "baud:" + String(baudRate));
+    CHECK(sinkLink.negotiate(command));
+    CHECK(sinkLink.baudRate() == baudRate);
+    sinkThread.join();
+}
+
+static void checkThroughput()
+{
+    double baseRate = 0;
+    double fastRate = 0;
+    std::thread sinkThread([&] { baseRate = sink.measureThroughput(20); });
+    sendReportLines(20);
+    sinkThread.join();
+
+    negotiate(115200);
+    sinkThread = std::thread([&] { fastRate = sink.measureThroughput(240); });
+    sendReportLines(240);
+    sinkThread.join();
+    printf("report lines: %.0f bytes/s at %u baud, %.0f bytes/s at 115200 baud\n", baseRate, BASE_BAUD_RATE,
+           fastRate);
+    CHECK_NEAR(baseRate, BASE_BAUD_RATE / 10.0, BASE_BAUD_RATE / 100.0);
+    CHECK(fastRate > 10 * baseRate);
+}
+
+// the sink restarted at the base rate while the node still runs fast:
+// its commands arrive garbled, the node falls back and the sink reads
+// the "baudreset" sent at the base rate
+static void checkFallbackAfterSinkReset()
+{
+    std::thread sinkThread([] {
+        sink.setBaudRate(BASE_BAUD_RATE);
+        for (int i = 0; i < LINK_ERROR_LIMIT; i++)
+        {
+            sink.send("12:00");
+            usleep(2 * LINK_LINE_GAP * 1000);
+        }
+        CHECK(sink.waitFor("baudreset", 2000));
+        sink.send("12:00");
+    });
+    CHECK(nodeWaitsForFallback(5000));
+    CHECK(nodeCommand() == "12:00");
+    sinkThread.join();
+}
+
+// noise garbles commands while both ends still run fast: the first
+// "baudreset" goes out at the old rate, so the sink reads it intact
+// before it switches back itself
+static void checkFallbackOnNoise()
+{
+    negotiate(57600);
+    std::thread sinkThread([] {
+        for (int i = 0; i < LINK_ERROR_LIMIT; i++)
+        {
+            sink.send("12:00", 2);
+            usleep(2 * LINK_LINE_GAP * 1000);
+        }
+        String line;
+        CHECK(sink.readLine(&line, 2000) && (line == "baudreset"));
+        sink.setBaudRate(BASE_BAUD_RATE);
+        sink.send("12:00");
+    });
+    CHECK(nodeWaitsForFallback(5000));
+    CHECK(nodeCommand() == "12:00");
+    sinkThread.join();
+}
+
+// an occasional error between good lines must not drop the rate
+static void checkScatteredErrors()
+{
+    negotiate(115200);
+    const int rounds = 10;
+    std::thread sinkThread([] {
+        for (int i = 0; i < rounds; i++)
+        {
+            sink.send("12:00", 1);
+            usleep(2 * LINK_LINE_GAP * 1000);
+            sink.send("ping");
+        }
+    });
+    int pingCount = 0;
+    for (int i = 0; i < 2 * rounds; i++)
+    {
+        pingCount += (nodeCommand() == "ping");
+    }
+    sinkThread.join();
+    CHECK(pingCount == rounds);
+    CHECK(sinkLink.baudRate() == 115200);
+
+    // back to the base rate for the next check
+    sinkThread = std::thread([] {
+        for (int i = 0; i < LINK_ERROR_LIMIT; i++)
+        {
+            sink.send("ping", 0);
+        }
+        CHECK(sink.waitFor("baudreset", 2000));
+        sink.setBaudRate(BASE_BAUD_RATE);
+    });
+    CHECK(nodeWaitsForFallback(5000));
+    sinkThread.join();
+}
+
+// the sink never confirms the new rate (e.g. its XBee kept the old one):
+// the node returns to the base rate by itself
+static void checkUnconfirmedRate()
+{
+    std::thread sinkThread([] {
+        sink.send("baud:38400");
+        CHECK(sink.waitFor("baudok:38400", 2000));
+        usleep((LINK_VERIFY_TIMEOUT + 500) * 1000);
+        sink.send("12:00");
+    });
+    String command = nodeCommand();
+    CHECK(!sinkLink.negotiate(command));
+    CHECK(sinkLink.baudRate() == BASE_BAUD_RATE);
+    CHECK(nodeCommand() == "12:00");
+    sinkThread.join();
+}
+
+int main()
+{
+    int nodeFd;
+    struct termios raw;
+    cfmakeraw(&raw);
+    if (openpty(&sink.fd, &nodeFd, NULL, &raw, NULL) != 0)
+    {
+        printf("openpty failed\n");
+        return 1;
+    }
+    Serial.hostAttach(nodeFd);
+    sinkLink.begin();
+
+    checkThroughput();
+    checkFallbackAfterSinkReset();
+    checkFallbackOnNoise();
+    checkScatteredErrors();
+    checkUnconfirmedRate();
+    return testResult("test_link");
+}
@@ -0,0 +1,108 @@
+// ESP_Profiler buckets, report and replay handling, plus the cost of
+// timing a stage
+#include "ESP_PH.h"
+#include "test.h"
+
+extern ESP_Trace trace;
+extern ESP_Profiler profiler;
+extern ESP_TempProbes tempProbes;
+
+static int phInput(uint8_t pin)
+{
+    return 2000 + (micros() & 7); // a little noise so the health check passes
+}
+
+// "<stage>:<count>,..." of the report, -1 when missing
+static long stageCount(const String &report, const char *stage)
+{
+    int field = report.indexOf(String(";") + stage + ":");
+    if (field < 0)
+    {
+        return -1;
+    }
+    return report.substring(field + strlen(stage) + 2).toInt();
+}
+
+static String profileReport()
+{
+    Serial.hostClear();
+    profiler.report(&Serial);
+    return Serial.hostTransmitted();
+}
+
+static void checkBucketsAndReport()
+{
+    profiler.reset();
+    for (int i = 0; i < 10; i++)
+    {
+        // 100000 cycles ago: bucket 16 covers [65536, 131072)
+        profiler.stop(STAGE_ADC_READ, ESP.getCycleCount() - 100000);
+    }
+    profiler.count(COUNTER_I2C_ERROR);
+    profiler.count(COUNTER_I2C_ERROR);
+    String report = profileReport();
+    CHECK(report.startsWith("Stats#CpuMHz:240;"));
+    CHECK(stageCount(report, "ADC") == 10);
+    CHECK(report.indexOf(" 16:10 ") > 0 || report.indexOf(",16:10 ") > 0);
+    CHECK(stageCount(report, "ADS") == 0);
+    CHECK(report.indexOf(";I2CError:2;") > 0);
+    // mean of ~100000 cycles at 240 MHz is ~416 us
+    int mean = report.substring(report.indexOf(";ADC:10,") + 8).toInt();
+    CHECK(mean >= 416 && mean < 430);
+}
+
+// a replayed cycle must leave the statistics as they were
+static void checkReplayIsNotProfiled()
+{
+    hostAnalogRead = phInput;
+    hostAddProbe(26.5f, 9);
+    EEPROM.write(TEMP_PROBE_EEPROM_ADDRESS, 0xFF); // no stored probes: search the bus
+    tempProbes.begin();
+    ESP_PH ph;
+    ph.begin();
+    ph._enableSensor = true;
+
+    profiler.reset();
+    trace.startRecording();
+    ph.updateVoltAndValue();
+    trace.stop();
+    float recordedValue = ph._value;
+    String report = profileReport();
+    CHECK(stageCount(report, "Measure") == 1);
+    CHECK(stageCount(report, "ADC") > 0);
+    CHECK(stageCount(report, "Temp") > 0);
+
+    trace.startReplay();
+    ph.updateVoltAndValue();
+    trace.stop();
+    CHECK(!trace.isError());
+    CHECK(ph._status == STATUS_OK);
+    CHECK(ph._value == recordedValue);
+    CHECK(profileReport() == report);
+}
+
+// ns per start()/stop() pair on the host; what a stage costs on top of
+// the work it times
+static void measureOverhead()
+{
+    const int pairs = 2000000;
+    profiler.reset();
+    double start = hostSeconds();
+    for (int i = 0; i < pairs; i++)
+    {
+        uint32_t startCycles = profiler.start();
+        profiler.stop(STAGE_ADC_READ, startCycles);
+    }
+    double pairCost = (hostSeconds() - start) / pairs * 1e9;
+    printf("start/stop pair: %.1f ns (host), %zu bytes of RTC memory\n", pairCost, sizeof(ESP_Profiler));
+    CHECK(pairCost < 500);
+    CHECK(sizeof(ESP_Profiler) < 1024); // RTC slow memory is 8 KB for everything kept in deep sleep
+}
+
+int main()
+{
+    checkBucketsAndReport();
+    checkReplayIsNotProfiled();
+    measureOverhead();
+    return testResult("test_profiler");
+}
@@ -0,0 +1,291 @@
+// auto-ranging: the same input gives the same millivolts at every
+// ADS1115 gain and on average the same as the original truncated count
+// at the EC calibration points, a ranged burst that clips runs again at
+// GAIN_ONE, the ESP32 ADC channels stay at 11 dB, and
+// RANGED_BURST_SAMPLE_COUNT from a samples-to-precision simulation of
+// the ADS1115
+#include "ESP_EC.h"
+#include "ESP_PH.h"
+#include "test.h"
+
+#include <climits>
+#include <random>
+
+// reach the protected range hooks through the base class
+struct SensorAccess : ESP_Sensor
+{
+    using ESP_Sensor::_burstSampleCount;
+    using ESP_Sensor::_coarseMaxRaw;
+    using ESP_Sensor::_voltage;
+    using ESP_Sensor::convertRawToVolt;
+    using ESP_Sensor::readRawSample;
+    using ESP_Sensor::resetRange;
+    using ESP_Sensor::selectRange;
+};
+
+extern Adafruit_ADS1115 ads;
+extern ESP_TempProbes tempProbes;
+
+// the ADS1115 board correction on an exact GAIN_ONE count / 10
+static double correction(double x)
+{
+    return 0.0000022091 * x * x * x - 0.00243269 * x * x + 1.74097 * x - 8.11739;
+}
+
+static double correctionSlope(double x)
+{
+    return 3 * 0.0000022091 * x * x - 2 * 0.00243269 * x + 1.74097;
+}
+
+static double gainFullScaleOf(adsGain_t gain)
+{
+    switch (gain)
+    {
+    case GAIN_SIXTEEN:
+        return 256;
+    case GAIN_EIGHT:
+        return 512;
+    case GAIN_FOUR:
+        return 1024;
+    case GAIN_TWO:
+        return 2048;
+    default:
+        return 4096;
+    }
+}
+
+// the EC range for a pre-burst peak of peakMillivolts
+static void selectEcRange(ESP_Sensor *ec, float peakMillivolts)
+{
+    (ec->*(&SensorAccess::resetRange))();
+    ec->*(&SensorAccess::_coarseMaxRaw) = peakMillivolts / 0.125f;
+    (ec->*(&SensorAccess::selectRange))();
+}
+
+static float readMillivolts(ESP_Sensor *ec)
+{
+    int raw = (ec->*(&SensorAccess::readRawSample))();
+    return (ec->*(&SensorAccess::convertRawToVolt))(raw);
+}
+
+// every input is read at each gain that holds it; each reading must be
+// within half a code of that gain of the exact corrected value, so two
+// gains never differ by more than the coarser one's resolution
+static void checkSameMillivolts(ESP_Sensor *ec)
+{
+    const float peaks[] = {100, 300, 700, 1500, 3500}; // one per gain, narrowest first
+    double worstSpread = 0;
+    for (float input = 1; input < 3300; input *= 1.05f)
+    {
+        hostAdsMillivolts = input;
+        double exact = correction(input / 0.125 / 10 - ADS_TRUNCATION_OFFSET);
+        float lowest = INFINITY;
+        float highest = -INFINITY;
+        for (float peak : peaks)
+        {
+            selectEcRange(ec, peak);
+            double fullScale = gainFullScaleOf(ads.getGain());
+            if (input >= fullScale)
+            {
+                continue;
+            }
+            float reading = readMillivolts(ec);
+            double halfCode = 0.5 * fullScale / 4096 / 10 * correctionSlope(input / 0.125 / 10 - ADS_TRUNCATION_OFFSET);
+            CHECK_NEAR(reading, exact, halfCode + 0.001);
+            lowest = fmin(lowest, reading);
+            highest = fmax(highest, reading);
+        }
+        worstSpread = fmax(worstSpread, highest - lowest);
+    }
+    printf("same input at every gain: readings at most %.4f mV apart\n", worstSpread);
+}
+
+// whatever the pre-burst peak, the ESP32 ADC keeps 11 dB and its scale
+static void checkEsp32Range(ESP_Sensor *ph)
+{
+    const int peaks[] = {10, 500, 1300, 2700, 4095};
+    for (int peak : peaks)
+    {
+        (ph->*(&SensorAccess::resetRange))();
+        ph->*(&SensorAccess::_coarseMaxRaw) = peak;
+        (ph->*(&SensorAccess::selectRange))();
+        CHECK(ph->*(&SensorAccess::_burstSampleCount) == BURST_SAMPLE_COUNT);
+        CHECK_NEAR((ph->*(&SensorAccess::convertRawToVolt))(4095), 3300, 0.01);
+    }
+}
+
+// the original integer count / 10 against the finer input with
+// ADS_TRUNCATION_OFFSET, on average over inputs around an EC calibration
+// point: the same voltage, so the stored calibrations still hold
+static void checkCalibrationPoint(ESP_Sensor *ec, double calibVolt)
+{
+    double low = 0;
+    double high = 3300;
+    while (high - low > 1e-6) // GAIN_ONE counts / 10 of the calibration voltage
+    {
+        double middle = (low + high) / 2;
+        (correction(middle) < calibVolt) ? (low = middle) : (high = middle);
+    }
+    std::mt19937 random(11);
+    std::uniform_real_distribution<double> input(low * 10 - 50, low * 10 + 50); // GAIN_ONE counts
+    std::normal_distribution<double> gaussian(0, 1);
+    (ec->*(&SensorAccess::resetRange))();
+    const int trials = 200000;
+    double shift = 0;
+    double untruncatedShift = 0;
+    for (int trial = 0; trial < trials; trial++)
+    {
+        int raw = lround(input(random) + gaussian(random));
+        double original = correction(raw / 10); // integer division, as it was
+        shift += (ec->*(&SensorAccess::convertRawToVolt))(raw) - original;
+        untruncatedShift += correction(raw / 10.0) - original;
+    }
+    shift /= trials;
+    untruncatedShift /= trials;
+    printf("EC calibration at %4.0f mV: mean shift %+.4f mV against the original (%+.4f mV without the offset)\n",
+           calibVolt, shift, untruncatedShift);
+    CHECK(fabs(shift) < fabs(untruncatedShift) / 10);
+}
+
+static unsigned long stepAfter; // conversions before the input steps up
+static float stepMillivolts;
+
+static int16_t steppedInput(float fullScaleMillivolts)
+{
+    float millivolts = (hostAdsConversions < stepAfter) ? hostAdsMillivolts : stepMillivolts;
+    return hostAdsQuantize(millivolts + (hostAdsConversions & 1) * 0.25f, fullScaleMillivolts); // not stuck
+}
+
+// the input rises past the range picked from the pre-burst: the clipped
+// burst runs again at GAIN_ONE and the reading is the new input, not the
+// top of the narrow range
+static void checkStepAfterPreBurst(ESP_Sensor *ec)
+{
+    const unsigned long steps[] = {HEALTH_SAMPLE_COUNT, HEALTH_SAMPLE_COUNT + 5,
+                                   HEALTH_SAMPLE_COUNT + 2 * RANGED_BURST_SAMPLE_COUNT};
+    int16_t (*previousConvert)(float) = hostAdsConvert;
+    hostAdsConvert = steppedInput;
+    hostAdsMillivolts = 100; // GAIN_SIXTEEN after the pre-burst
+    stepMillivolts = 1500;
+    double exact = correction((stepMillivolts + 0.125) / 0.125 / 10 - ADS_TRUNCATION_OFFSET);
+    for (unsigned long step : steps)
+    {
+        hostAdsConversions = 0;
+        stepAfter = step;
+        ec->updateVoltAndValue();
+        CHECK(ec->_status == STATUS_OK);
+        CHECK(ads.getGain() == GAIN_ONE);
+        float voltage = ec->*(&SensorAccess::_voltage);
+        if (step < HEALTH_SAMPLE_COUNT + RANGED_BURST_SAMPLE_COUNT) // during the first burst
+        {
+            // the clipped burst again and the four others, all at GAIN_ONE
+            CHECK(hostAdsConversions == HEALTH_SAMPLE_COUNT + RANGED_BURST_SAMPLE_COUNT + 5 * BURST_SAMPLE_COUNT);
+            CHECK_NEAR(voltage, exact, 0.5);
+            printf("step to %.0f mV after %lu conversions: %.2f mV (exact %.2f mV)\n", stepMillivolts, step,
+                   voltage, exact);
+        }
+        else // two bursts of the lower input, then three of the new one
+        {
+            double twoLow = 2 * correction(100.125 / 0.125 / 10 - ADS_TRUNCATION_OFFSET);
+            CHECK_NEAR(voltage, (twoLow + 3 * exact) / 5, 0.5);
+        }
+    }
+
+    stepAfter = ULONG_MAX; // no step: the narrow range is kept
+    hostAdsConversions = 0;
+    ec->updateVoltAndValue();
+    CHECK(ads.getGain() == GAIN_SIXTEEN);
+    CHECK(hostAdsConversions == HEALTH_SAMPLE_COUNT + 5 * RANGED_BURST_SAMPLE_COUNT);
+    hostAdsConvert = previousConvert;
+}
+
+// RMS error of a burst mean, in input mV, for every burst length from 1
+// to BURST_SAMPLE_COUNT, over inputs spread between lowInput and
+// highInput. Noise model of the ADS1115 at the 128 SPS the single-shot
+// read uses: Gaussian noise of up to 1 code RMS at every gain (the
+// datasheet's noise table gives one LSB at 128 SPS), plus signalNoise
+// mV RMS from the probe, then rounding to a code.
+static void simulateBursts(double fullScale, double lowInput, double highInput, double signalNoise,
+                           double *rmsError)
+{
+    const int trials = 20000;
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> input(lowInput, highInput);
+    std::normal_distribution<double> gaussian(0, 1);
+    double code = fullScale / 32768;
+    double squaredError[BURST_SAMPLE_COUNT + 1] = {0};
+    for (int trial = 0; trial < trials; trial++)
+    {
+        double millivolts = input(random);
+        double sum = 0;
+        for (int n = 1; n <= BURST_SAMPLE_COUNT; n++)
+        {
+            double noisy = millivolts + code * gaussian(random) + signalNoise * gaussian(random);
+            sum += round(noisy / code) * code;
+            double error = sum / n - millivolts;
+            squaredError[n] += error * error;
+        }
+    }
+    for (int n = 1; n <= BURST_SAMPLE_COUNT; n++)
+    {
+        rmsError[n] = sqrt(squaredError[n] / trials);
+    }
+}
+
+// the fewest samples with which every narrowed gain measures its inputs
+// at least as precisely as BURST_SAMPLE_COUNT samples at GAIN_ONE do
+static int rangedSampleCount(double signalNoise)
+{
+    const double fullScale[] = {256, 512, 1024, 2048, 4096}; // the gains, narrowest first
+    int needed = 1;
+    for (int g = 0; g < 4; g++)
+    {
+        // inputs for which selectRange() picks this gain
+        double lowInput = (g == 0) ? 1 : fullScale[g - 1] / (1 + AUTORANGE_HEADROOM);
+        double highInput = fullScale[g] / (1 + AUTORANGE_HEADROOM);
+        double widest[BURST_SAMPLE_COUNT + 1];
+        double narrowed[BURST_SAMPLE_COUNT + 1];
+        simulateBursts(4096, lowInput, highInput, signalNoise, widest);
+        simulateBursts(fullScale[g], lowInput, highInput, signalNoise, narrowed);
+        int n = 1;
+        while ((n < BURST_SAMPLE_COUNT) && (narrowed[n] > widest[BURST_SAMPLE_COUNT]))
+        {
+            n++;
+        }
+        needed = (n > needed) ? n : needed;
+    }
+    return needed;
+}
+
+static void checkRangedSampleCount()
+{
+    int needed = rangedSampleCount(0);
+    printf("ranged burst: %d samples match %d at GAIN_ONE (RANGED_BURST_SAMPLE_COUNT %d)\n", needed,
+           BURST_SAMPLE_COUNT, RANGED_BURST_SAMPLE_COUNT);
+    const double signalNoises[] = {0.05, 0.125, 0.5};
+    for (double signalNoise : signalNoises)
+    {
+        printf("  with %.3f mV RMS probe noise: %d samples\n", signalNoise, rangedSampleCount(signalNoise));
+    }
+    CHECK(RANGED_BURST_SAMPLE_COUNT >= needed);
+    CHECK(RANGED_BURST_SAMPLE_COUNT <= needed + 2); // and not much more, or ranging saves nothing
+}
+
+int main()
+{
+    hostAddProbe(25.0f, 9); // no temperature compensation at 25 ^C
+    EEPROM.write(TEMP_PROBE_EEPROM_ADDRESS, 0xFF);
+    tempProbes.begin();
+    ESP_EC ec;
+    ESP_PH ph;
+    ec.begin();
+    ec._enableSensor = true;
+    ec._tempProbe = 0;
+    checkSameMillivolts(&ec);
+    checkCalibrationPoint(&ec, 300);  // the default low and high EC calibration voltages
+    checkCalibrationPoint(&ec, 2400);
+    checkStepAfterPreBurst(&ec);
+    checkEsp32Range(&ph);
+    checkRangedSampleCount();
+    return testResult("test_ranging");
+}
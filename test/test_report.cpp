@@ -0,0 +1,323 @@
+// report-by-exception rules, a request that timed out, and the bytes it
+// saves on a series of readings
+//   build/test_report [readings.csv]
+// the optional CSV has one request per line: EC,Tbd,PH,NH3N,temperature
+// (as logged by the sink); without it a synthetic week is used
+#include "ESP_EC.h"
+#include "ESP_PH.h"
+#include "ESP_Turbidity.h"
+#include "ESP_NH3N.h"
+#include "ESP_Report.h"
+#include "test.h"
+
+#include <random>
+#include <vector>
+
+static ESP_Sensor *sensors[SENSOR_COUNT];
+static ESP_WindowStats shortStats[SENSOR_COUNT];
+static ESP_WindowStats longStats[SENSOR_COUNT];
+static unsigned long readingAge[SENSOR_COUNT];
+
+struct Reading
+{
+    float value[SENSOR_COUNT];
+    float temperature;
+};
+
+static void setReading(const Reading &reading)
+{
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        sensors[i]->_value = reading.value[i];
+        sensors[i]->_status = isnan(reading.value[i]) ? STATUS_OPEN_CIRCUIT : STATUS_OK;
+        sensors[i]->_temperature = reading.temperature;
+        sensors[i]->_derivedValue = NAN;
+    }
+}
+
+// one request for the current readings, completed unless it timed out
+static String sendReport(ESP_Report *report, bool isCompleted = true)
+{
+    report->select(sensors);
+    Serial.hostClear();
+    report->send(&Serial, "12:00", sensors, readingAge, shortStats, longStats);
+    if (isCompleted)
+    {
+        report->commit(sensors);
+    }
+    return Serial.hostTransmitted();
+}
+
+static bool isSent(const String &line, const String &name)
+{
+    int field = line.indexOf(";" + name + ":");
+    if (name == "Temperature")
+    {
+        field = line.indexOf(" ;Temperature:");
+        return line.substring(field + 14, field + 15) != "=";
+    }
+    return line.substring(field + name.length() + 2, field + name.length() + 3) != "=";
+}
+
+static void checkRules()
+{
+    ESP_Report report;
+    report.reset(true);
+    Reading reading = {{1.20f, 100.0f, 7.00f, 20.0f}, 27.0f};
+    setReading(reading);
+
+    String line = sendReport(&report); // first report after cold boot is full
+    CHECK(isSent(line, "EC") && isSent(line, "Tbd") && isSent(line, "PH") && isSent(line, "NH3N"));
+    CHECK(isSent(line, "Temperature"));
+    CHECK(line.indexOf("EC_S:") > 0);
+
+    line = sendReport(&report); // nothing moved
+    CHECK(!isSent(line, "EC") && !isSent(line, "Tbd") && !isSent(line, "PH") && !isSent(line, "NH3N"));
+    CHECK(!isSent(line, "Temperature"));
+    CHECK(line.indexOf("EC_S:") < 0); // statistics only go with their value
+    CHECK(line.indexOf("EC:=;") > 0);
+
+    reading.value[0] = 1.24f; // inside the 0.05 mS/cm deadband
+    reading.value[1] = 104.0f; // inside 5 % of 100 NTU
+    setReading(reading);
+    line = sendReport(&report);
+    CHECK(!isSent(line, "EC") && !isSent(line, "Tbd"));
+
+    reading.value[0] = 1.26f; // out of the EC deadband
+    reading.value[1] = 106.0f; // out of the relative turbidity deadband
+    reading.temperature = 27.3f;
+    setReading(reading);
+    line = sendReport(&report);
+    CHECK(isSent(line, "EC") && isSent(line, "Tbd") && !isSent(line, "PH"));
+    CHECK(isSent(line, "Temperature"));
+
+    // a failing probe: the value goes nan, then only the status changes
+    sensors[2]->_value = NAN;
+    sensors[2]->_status = STATUS_SATURATED;
+    line = sendReport(&report);
+    CHECK(isSent(line, "PH"));
+    CHECK(line.indexOf("PH_Status:3") > 0);
+    line = sendReport(&report);
+    CHECK(!isSent(line, "PH"));
+    sensors[2]->_status = STATUS_OPEN_CIRCUIT;
+    line = sendReport(&report);
+    CHECK(isSent(line, "PH"));
+    CHECK(line.indexOf("PH_Status:4") > 0);
+    sensors[2]->_value = 7.0f;
+    sensors[2]->_status = STATUS_OK;
+    line = sendReport(&report);
+    CHECK(isSent(line, "PH"));
+    CHECK(line.indexOf("PH_Status") < 0);
+
+    // heartbeat: an unchanged value is resent every HEARTBEAT_PERIOD requests
+    int sentCount = 0;
+    for (int i = 0; i < HEARTBEAT_PERIOD * 3; i++)
+    {
+        sentCount += isSent(sendReport(&report), "NH3N");
+    }
+    CHECK(sentCount == 3);
+
+    // full report every FULL_REPORT_PERIOD requests
+    ESP_Report full;
+    full.reset(true);
+    int fullCount = 0;
+    for (int i = 0; i < FULL_REPORT_PERIOD * 2; i++)
+    {
+        line = sendReport(&full);
+        fullCount += isSent(line, "EC") && isSent(line, "Tbd") && isSent(line, "PH") &&
+                     isSent(line, "NH3N") && isSent(line, "Temperature");
+    }
+    CHECK(fullCount >= 2);
+}
+
+// the sink never got what a timed-out request carried: the next request
+// sends it again, and a full report that timed out is full again
+static void checkTimeout()
+{
+    ESP_Report report;
+    report.reset(true);
+    Reading reading = {{1.20f, 100.0f, 7.00f, 20.0f}, 27.0f};
+    setReading(reading);
+    String line = sendReport(&report, false); // the first, full report times out
+    CHECK(isSent(line, "EC") && isSent(line, "NH3N") && isSent(line, "Temperature"));
+    line = sendReport(&report);
+    CHECK(isSent(line, "EC") && isSent(line, "Tbd") && isSent(line, "PH") && isSent(line, "NH3N"));
+    CHECK(isSent(line, "Temperature"));
+
+    reading.value[0] = 1.30f;
+    reading.temperature = 28.0f;
+    setReading(reading);
+    line = sendReport(&report, false);
+    CHECK(isSent(line, "EC") && !isSent(line, "PH") && isSent(line, "Temperature"));
+    line = sendReport(&report);
+    CHECK(isSent(line, "EC") && !isSent(line, "PH") && isSent(line, "Temperature"));
+    line = sendReport(&report);
+    CHECK(!isSent(line, "EC") && !isSent(line, "Temperature"));
+
+    // the heartbeat is not reset by a timeout either
+    ESP_Report quiet;
+    quiet.reset(true);
+    sendReport(&quiet);
+    for (int i = 1; i < HEARTBEAT_PERIOD; i++)
+    {
+        CHECK(!isSent(sendReport(&quiet), "PH"));
+    }
+    CHECK(isSent(sendReport(&quiet, false), "PH"));
+    CHECK(isSent(sendReport(&quiet), "PH"));
+    CHECK(!isSent(sendReport(&quiet), "PH"));
+}
+
+// without report-by-exception every value is sent on every request
+static void checkDisabled()
+{
+    ESP_Report report;
+    report.reset(false);
+    setReading({{1.20f, 100.0f, 7.00f, 20.0f}, 27.0f});
+    for (int i = 0; i < 3; i++)
+    {
+        String line = sendReport(&report);
+        CHECK(isSent(line, "EC") && isSent(line, "Tbd") && isSent(line, "PH") && isSent(line, "NH3N"));
+        CHECK(isSent(line, "Temperature"));
+    }
+}
+
+// each probe reports what a sensor bound to it read, never what a
+// disabled sensor or one that failed before the temperature still holds
+static void checkProbeTemperatures()
+{
+    ESP_Report report;
+    report.reset(true);
+    setReading({{1.20f, 100.0f, 7.00f, 20.0f}, 27.0f});
+    sensors[0]->_enableSensor = false; // EC, disabled: its temperature is stale
+    sensors[0]->_temperature = 85.0f;
+    sensors[2]->_tempProbe = 1;
+    sensors[2]->_temperature = 21.5f;
+    sensors[3]->_tempProbe = 1;
+    sensors[3]->_status = STATUS_I2C_ERROR; // aborted before reading its probe
+    sensors[3]->_temperature = 99.0f;
+    String line = sendReport(&report);
+    CHECK(line.indexOf(" ;Temperature:27.00 ;") > 0);
+    CHECK(line.indexOf(";Temperature1:21.50 ;") > 0);
+    CHECK(line.indexOf(";Temperature2:") < 0); // no sensor bound to it
+
+    line = sendReport(&report); // nothing moved
+    CHECK(line.indexOf(" ;Temperature:=;Temperature1:=;") > 0);
+
+    sensors[2]->_status = STATUS_I2C_ERROR; // no sensor read probe 1
+    line = sendReport(&report);
+    CHECK(line.indexOf(";Temperature1:nan ;") > 0);
+
+    sensors[0]->_enableSensor = true;
+    sensors[2]->_tempProbe = 0;
+    sensors[3]->_tempProbe = 0;
+}
+
+// a week of 10-minute requests: daily cycles, noise and a few upsets
+static std::vector<Reading> syntheticWeek()
+{
+    std::vector<Reading> readings;
+    std::mt19937 random(7);
+    std::normal_distribution<float> gaussian(0, 1);
+    const float mean[] = {1.2f, 120.0f, 7.2f, 25.0f};
+    const float daily[] = {0.1f, 30.0f, 0.15f, 5.0f};
+    const float noise[] = {0.01f, 2.0f, 0.02f, 0.3f};
+    for (int i = 0; i < 7 * 144; i++)
+    {
+        float phase = 2 * M_PI * i / 144.0f;
+        bool isUpset = (i % 300) > 290; // a short upset now and then
+        Reading reading;
+        for (int s = 0; s < SENSOR_COUNT; s++)
+        {
+            reading.value[s] = mean[s] + daily[s] * sinf(phase + s) + noise[s] * gaussian(random);
+            if (isUpset)
+            {
+                reading.value[s] *= 1.3f;
+            }
+        }
+        reading.temperature = 27.0f + 1.5f * sinf(phase) + 0.05f * gaussian(random);
+        readings.push_back(reading);
+    }
+    return readings;
+}
+
+static std::vector<Reading> readCsv(const char *path)
+{
+    std::vector<Reading> readings;
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+    {
+        printf("cannot open %s\n", path);
+        return readings;
+    }
+    Reading reading;
+    while (fscanf(file, "%f,%f,%f,%f,%f", &reading.value[0], &reading.value[1], &reading.value[2],
+                  &reading.value[3], &reading.temperature) == 5)
+    {
+        readings.push_back(reading);
+    }
+    fclose(file);
+    return readings;
+}
+
+static void measureBytes(const std::vector<Reading> &readings, const char *name)
+{
+    CHECK(!readings.empty());
+    if (readings.empty())
+    {
+        return;
+    }
+    ESP_Report byException;
+    ESP_Report full;
+    byException.reset(true);
+    full.reset(false); // every report full, as without REPORT_BY_EXCEPTION
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        shortStats[i].reset(STATS_SHORT_HORIZON);
+        longStats[i].reset(STATS_LONG_HORIZON);
+    }
+    unsigned long exceptionBytes = 0;
+    unsigned long fullBytes = 0;
+    for (const Reading &reading : readings)
+    {
+        setReading(reading);
+        for (int i = 0; i < SENSOR_COUNT; i++)
+        {
+            shortStats[i].push(reading.value[i]);
+            longStats[i].push(reading.value[i]);
+        }
+        exceptionBytes += sendReport(&byException).length();
+        fullBytes += sendReport(&full).length();
+    }
+    printf("%s: %zu requests, %lu bytes full, %lu bytes by exception (%.0f %% less)\n", name,
+           readings.size(), fullBytes, exceptionBytes, 100.0 * (fullBytes - exceptionBytes) / fullBytes);
+    CHECK(exceptionBytes < fullBytes);
+}
+
+int main(int argc, char **argv)
+{
+    sensors[0] = new ESP_EC;
+    sensors[1] = new ESP_Turbidity;
+    sensors[2] = new ESP_PH;
+    sensors[3] = new ESP_NH3N;
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        sensors[i]->_enableSensor = true;
+        sensors[i]->_tempProbe = 0;
+        shortStats[i].reset(STATS_SHORT_HORIZON);
+        longStats[i].reset(STATS_LONG_HORIZON);
+    }
+
+    checkRules();
+    checkTimeout();
+    checkDisabled();
+    checkProbeTemperatures();
+    if (argc > 1)
+    {
+        measureBytes(readCsv(argv[1]), argv[1]);
+    }
+    else
+    {
+        measureBytes(syntheticWeek(), "synthetic week");
+    }
+    return testResult("test_report");
+}
@@ -0,0 +1,321 @@
+// ESP_Stream over a pseudo terminal to a simulated sink, as in
+// test_link: the sustained frame rate with no drops on a fast link, a
+// link too slow for the frames dropping whole frames at the same
+// sampling rate, every sampled frame either sent or counted as a drop,
+// and the ends of a stream by "stop", timeout and the stop pin
+#include "ESP_EC.h"
+#include "ESP_NH3N.h"
+#include "ESP_PH.h"
+#include "ESP_Stream.h"
+#include "ESP_Turbidity.h"
+#include "test.h"
+
+#include <poll.h>
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+#include <thread>
+
+#define STOP_PIN 26
+
+extern ESP_TempProbes tempProbes;
+
+static ESP_Link sinkLink(&Serial);
+static ESP_Stream liveStream(&Serial, &sinkLink, STOP_PIN);
+static ESP_Sensor *sensors[SENSOR_COUNT];
+
+// every analogRead() of the sampling task, one per sensor and frame
+static std::atomic<unsigned long> analogReadCount(0);
+
+static int noisyInput(uint8_t pin)
+{
+    analogReadCount++;
+    return 2000 + (micros() & 7);
+}
+
+// the Sink Node's end of the pseudo terminal
+class Sink
+{
+public:
+    int fd;
+
+    void setBaudRate(unsigned long baudRate)
+    {
+        _baudRate = baudRate;
+        Serial.hostPeerBaudRate = baudRate;
+    }
+
+    void send(const String &line)
+    {
+        String bytes = line + "\n";
+        for (unsigned int i = 0; i < bytes.length(); i++)
+        {
+            hostPaceByte(&_nextByteTime, _baudRate);
+            uint8_t c = bytes[i];
+            CHECK(::write(fd, &c, 1) == 1);
+        }
+    }
+
+    // the next line without its CR, false on timeout
+    bool readLine(String *line, int timeoutMs)
+    {
+        double deadline = hostSeconds() + timeoutMs / 1000.0;
+        while (true)
+        {
+            size_t end = _received.find('\n');
+            if (end != std::string::npos)
+            {
+                *line = String(_received.substr(0, end));
+                _received.erase(0, end + 1);
+                if (line->endsWith("\r"))
+                {
+                    *line = line->substring(0, line->length() - 1);
+                }
+                return true;
+            }
+            double remaining = deadline - hostSeconds();
+            if (remaining <= 0)
+            {
+                return false;
+            }
+            struct pollfd pfd = {fd, POLLIN, 0};
+            if (poll(&pfd, 1, (int)(remaining * 1000) + 1) > 0)
+            {
+                char buffer[256];
+                ssize_t count = ::read(fd, buffer, sizeof(buffer));
+                if (count > 0)
+                {
+                    _received.append(buffer, count);
+                }
+            }
+        }
+    }
+
+    bool waitFor(const String &expected, int timeoutMs)
+    {
+        double deadline = hostSeconds() + timeoutMs / 1000.0;
+        String line;
+        while (readLine(&line, (int)((deadline - hostSeconds()) * 1000)))
+        {
+            if (line.endsWith(expected))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    unsigned long _baudRate = BASE_BAUD_RATE;
+    std::chrono::steady_clock::time_point _nextByteTime;
+    std::string _received;
+};
+
+static Sink sink;
+
+// what the sink saw of one stream
+struct Received
+{
+    String header;
+    unsigned long frames = 0;       // frame lines
+    unsigned long gaps = 0;         // frames missing between the sequence numbers
+    unsigned long firstSequence = 0;
+    unsigned long lastSequence = 0;
+    unsigned long firstTime = 0;    // ms on the node
+    unsigned long lastTime = 0;
+    int fieldCount = 0;             // of the last frame
+    unsigned long reportedFrames = 0;
+    unsigned long reportedDrops = 0;
+    double seconds = 0;             // wall time from the header to the end line
+    bool isEnded = false;
+
+    // sampled frames per second, from the node's timestamps
+    double samplingRate() const
+    {
+        return (lastSequence - firstSequence) * 1000.0 / (lastTime - firstTime);
+    }
+};
+
+// reads a stream until its end line, sending "stop" after stopAfter s
+static void receiveStream(Received *received, double stopAfter)
+{
+    String line;
+    if (!sink.readLine(&line, 3000))
+    {
+        return;
+    }
+    received->header = line;
+    double start = hostSeconds();
+    bool isStopSent = false;
+    while (sink.readLine(&line, 2000))
+    {
+        if ((stopAfter > 0) && !isStopSent && (hostSeconds() - start > stopAfter))
+        {
+            sink.send("stop");
+            isStopSent = true;
+        }
+        if (line.startsWith("Stream#end;frames:"))
+        {
+            received->seconds = hostSeconds() - start;
+            received->reportedFrames = line.substring(18).toInt();
+            received->reportedDrops = line.substring(line.indexOf(";drops:") + 7).toInt();
+            received->isEnded = true;
+            return;
+        }
+        CHECK(line.startsWith("S"));
+        unsigned long sequence = line.substring(1).toInt();
+        unsigned long time = line.substring(line.indexOf(',') + 1).toInt();
+        if (received->frames == 0)
+        {
+            received->firstSequence = sequence;
+            received->firstTime = time;
+            CHECK(sequence == 0);
+        }
+        else
+        {
+            CHECK(sequence > received->lastSequence);
+            received->gaps += sequence - received->lastSequence - 1;
+        }
+        received->lastSequence = sequence;
+        received->lastTime = time;
+        received->fieldCount = 1;
+        for (int i = line.indexOf(','); i >= 0; i = line.indexOf(',', i + 1))
+        {
+            received->fieldCount++;
+        }
+        received->frames++;
+    }
+}
+
+// runs one stream command on the node while the sink receives it
+static void stream(const String &command, Received *received, double stopAfter)
+{
+    analogReadCount = 0;
+    std::thread sinkThread([received, stopAfter] { receiveStream(received, stopAfter); });
+    liveStream.run(command, sensors);
+    sinkThread.join();
+    CHECK(received->isEnded);
+}
+
+static void negotiate(unsigned long baudRate)
+{
+    std::thread sinkThread([baudRate] {
+        sink.send("baud:" + String(baudRate));
+        CHECK(sink.waitFor("baudok:" + String(baudRate), 2000));
+        sink.setBaudRate(baudRate);
+        usleep(10000);
+        sink.send("baudcheck");
+        CHECK(sink.waitFor("baudconfirmed", 2000));
+    });
+    CHECK(sinkLink.negotiate(sinkLink.readCommand()));
+    sinkThread.join();
+}
+
+static void checkCommand()
+{
+    CHECK(ESP_Stream::isCommand("stream"));
+    CHECK(ESP_Stream::isCommand("stream:"));
+    CHECK(ESP_Stream::isCommand("stream:5,20,1,120"));
+    CHECK(!ESP_Stream::isCommand("streams"));
+    CHECK(!ESP_Stream::isCommand("streamfoo"));
+    CHECK(!ESP_Stream::isCommand("12:00"));
+}
+
+// fast enough for every frame: all arrive, in order, at the full rate
+static void checkSustainedRate()
+{
+    Received received;
+    stream("stream:,50,0,10", &received, 3.0);
+    unsigned long sampled = analogReadCount / 3;
+    printf("115200 baud, 50 Hz: %lu frames in %.2f s, sampled at %.1f Hz, %lu drops\n", received.frames,
+           received.seconds, received.samplingRate(), received.reportedDrops);
+    CHECK(received.header == "Stream#50;Tbd,PH,NH3N,;raw:0");
+    CHECK(received.fieldCount == 2 + 3);
+    CHECK(received.frames == received.reportedFrames);
+    CHECK(received.reportedDrops == 0);
+    CHECK(received.gaps == 0);
+    CHECK(received.frames == sampled);
+    CHECK_NEAR(received.samplingRate(), 50, 1);
+    CHECK_NEAR(received.frames / received.seconds, 50, 3);
+}
+
+// too slow for 50 frames with raw codes: whole frames are dropped, the
+// sampling keeps its rate, and the counts add up to the frames sampled
+static void checkDrops()
+{
+    Received received;
+    stream("stream:,50,1,10", &received, 3.0);
+    unsigned long sampled = analogReadCount / 3;
+    printf("9600 baud, 50 Hz with raw codes: %lu frames and %lu drops of %lu sampled, %.1f frames/s sent, "
+           "sampled at %.1f Hz\n",
+           received.frames, received.reportedDrops, sampled, received.frames / received.seconds,
+           received.samplingRate());
+    CHECK(received.fieldCount == 2 + 3 + 3);
+    CHECK(received.frames == received.reportedFrames);
+    CHECK(received.reportedDrops > 0);
+    CHECK(received.reportedFrames + received.reportedDrops == sampled);
+    CHECK(received.gaps > 0);
+    CHECK(received.gaps <= received.reportedDrops); // the rest were still queued at the end
+    CHECK(received.lastSequence < sampled);
+    CHECK_NEAR(received.samplingRate(), 50, 1);
+    CHECK(received.frames / received.seconds < 25);
+}
+
+static void checkEnds()
+{
+    Received timedOut;
+    stream("stream:,20,0,1", &timedOut, 0);
+    CHECK_NEAR(timedOut.seconds, 1.0, 0.2);
+    CHECK_NEAR(timedOut.reportedFrames, 20, 2);
+
+    Received pinStopped;
+    std::thread pinThread([] {
+        usleep(500000);
+        hostDigitalLevel[STOP_PIN] = LOW;
+    });
+    stream("stream:,20,0,10", &pinStopped, 0);
+    pinThread.join();
+    hostDigitalLevel[STOP_PIN] = HIGH;
+    CHECK_NEAR(pinStopped.seconds, 0.5, 0.2);
+
+    // EC alone, which is disabled
+    std::thread sinkThread([] { CHECK(sink.waitFor("streamerror", 2000)); });
+    liveStream.run("stream:1", sensors);
+    sinkThread.join();
+}
+
+int main()
+{
+    hostAnalogRead = noisyInput;
+    hostDigitalLevel[STOP_PIN] = HIGH;
+    hostAddProbe(24.0f, 9);
+    EEPROM.write(TEMP_PROBE_EEPROM_ADDRESS, 0xFF);
+    tempProbes.begin();
+    sensors[0] = new ESP_EC;
+    sensors[1] = new ESP_Turbidity;
+    sensors[2] = new ESP_PH;
+    sensors[3] = new ESP_NH3N;
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        sensors[i]->begin();
+        sensors[i]->_enableSensor = (i != 0); // no ADS1115: its delays would run the clock ahead
+    }
+
+    int nodeFd;
+    struct termios raw;
+    cfmakeraw(&raw);
+    if (openpty(&sink.fd, &nodeFd, NULL, &raw, NULL) != 0)
+    {
+        printf("openpty failed\n");
+        return 1;
+    }
+    Serial.hostAttach(nodeFd); // after begin(), which logs the EEPROM values
+    sinkLink.begin();
+
+    checkCommand();
+    checkDrops();
+    negotiate(115200);
+    checkSustainedRate();
+    checkEnds();
+    return testResult("test_stream");
+}
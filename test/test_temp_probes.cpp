@@ -0,0 +1,154 @@
+// ESP_TempProbes on a simulated OneWire bus: the transactions of a
+// reading against the library's requestTemperaturesByAddress(), which
+// reads the whole scratchpad through getResolution() before it starts
+// the conversion, no bus search after a reboot, the conversion wait per
+// resolution, missing or corrupt probes, and a parasite powered probe
+#include "ESP_Sensor.h"
+#include "test.h"
+
+extern OneWire oneWire;
+extern DallasTemperature tempSensor;
+
+static void checkEnumerate()
+{
+    EEPROM.write(TEMP_PROBE_EEPROM_ADDRESS, 0xFF); // new EEPROM
+    hostClearOneWireCounters();
+    ESP_TempProbes probes(&oneWire, &tempSensor);
+    probes.begin();
+    CHECK(probes.count() == 2);
+    CHECK(hostOneWire.searches > 0);
+
+    hostClearOneWireCounters(); // reboot: the addresses come from EEPROM
+    ESP_TempProbes rebooted(&oneWire, &tempSensor);
+    rebooted.begin();
+    CHECK(rebooted.count() == 2);
+    CHECK(hostOneWire.searches == 0);
+    CHECK(hostOneWire.resets == 0);
+}
+
+static void checkTransactions()
+{
+    ESP_TempProbes probes(&oneWire, &tempSensor);
+    probes.begin();
+
+    // the library's way: a scratchpad read for the resolution, the
+    // conversion, then the scratchpad read for the temperature
+    hostClearOneWireCounters();
+    tempSensor.requestTemperaturesByAddress(hostProbes[0].rom);
+    float libraryTemperature = tempSensor.getTempC(hostProbes[0].rom);
+    unsigned long libraryResets = hostOneWire.resets;
+    unsigned long libraryBytes = hostOneWire.bytesRead;
+    CHECK(hostOneWire.commands[READSCRATCH] == 2);
+    CHECK(hostOneWire.commands[STARTCONVO] == 1);
+
+    hostClearOneWireCounters();
+    float temperature = probes.read(0);
+    printf("one reading: %lu resets, %lu bytes read (library: %lu resets, %lu bytes read)\n", hostOneWire.resets,
+           hostOneWire.bytesRead, libraryResets, libraryBytes);
+    CHECK(hostOneWire.commands[READSCRATCH] == 1);
+    CHECK(hostOneWire.commands[STARTCONVO] == 1);
+    CHECK(hostOneWire.searches == 0);
+    CHECK(hostOneWire.bytesRead == 9);
+    CHECK(hostOneWire.resets < libraryResets);
+    CHECK(temperature == libraryTemperature);
+    CHECK_NEAR(temperature, 23.4375, 0.0001); // 23.45 ^C at 12 bits
+
+    CHECK_NEAR(probes.read(1), 18.5, 0.0001); // 18.6 ^C at 9 bits: 0.5 ^C steps
+}
+
+// the wait follows the stored resolution of each probe
+static void checkConversionWait()
+{
+    ESP_TempProbes probes(&oneWire, &tempSensor);
+    probes.begin();
+    unsigned long start = millis();
+    probes.read(0);
+    unsigned long twelveBits = millis() - start;
+    start = millis();
+    probes.read(1);
+    unsigned long nineBits = millis() - start;
+    printf("conversion: %lu ms at 12 bits, %lu ms at 9 bits\n", twelveBits, nineBits);
+    CHECK(twelveBits >= 750 && twelveBits < 760);
+    CHECK(nineBits >= 94 && nineBits < 104);
+}
+
+static void checkFaults()
+{
+    ESP_TempProbes probes(&oneWire, &tempSensor);
+    probes.begin();
+    CHECK(probes.read(MAX_TEMP_PROBES) == DEVICE_DISCONNECTED_C);
+
+    hostProbes[1].isCorrupt = true;
+    CHECK(probes.read(1) == DEVICE_DISCONNECTED_C);
+    hostProbes[1].isCorrupt = false;
+
+    hostProbes[1].isConnected = false;
+    CHECK(probes.read(1) == DEVICE_DISCONNECTED_C);
+    CHECK_NEAR(probes.read(0), 23.4375, 0.0001); // the other probe still answers
+
+    hostProbes[0].isConnected = false; // empty bus: no presence pulse, no conversion
+    hostClearOneWireCounters();
+    CHECK(probes.read(0) == DEVICE_DISCONNECTED_C);
+    CHECK(hostOneWire.commands[STARTCONVO] == 0);
+    hostProbes[0].isConnected = true;
+    hostProbes[1].isConnected = true;
+}
+
+// a parasite powered probe only converts with the strong pull-up on;
+// the flag is found with the bus search and kept in EEPROM with it
+static void checkParasitePower()
+{
+    const int flagAddress = TEMP_PROBE_EEPROM_ADDRESS + 1 + MAX_TEMP_PROBES * 9;
+    hostProbes[1].isParasite = true;
+    hostProbes[1].temperature = 30.0f;
+
+    oneWire.reset(); // the old way, without the pull-up: the conversion never happens
+    oneWire.select(hostProbes[1].rom);
+    oneWire.write(STARTCONVO);
+    CHECK_NEAR(tempSensor.getTempC(hostProbes[1].rom), 18.5, 0.0001);
+
+    EEPROM.write(TEMP_PROBE_EEPROM_ADDRESS, 0xFF);
+    ESP_TempProbes probes(&oneWire, &tempSensor);
+    probes.begin();
+    CHECK(EEPROM.read(flagAddress) == 1);
+    hostClearOneWireCounters();
+    CHECK_NEAR(probes.read(1), 30.0, 0.0001);
+    CHECK(hostOneWire.poweredWrites == 1);
+
+    hostClearOneWireCounters(); // reboot: the flag comes from EEPROM with the addresses
+    ESP_TempProbes rebooted(&oneWire, &tempSensor);
+    rebooted.begin();
+    CHECK(hostOneWire.resets == 0);
+    hostProbes[1].temperature = 31.0f;
+    CHECK_NEAR(rebooted.read(1), 31.0, 0.0001);
+
+    EEPROM.write(flagAddress, 0xFF); // stored without the flag: one bus query, then kept
+    hostClearOneWireCounters();
+    ESP_TempProbes upgraded(&oneWire, &tempSensor);
+    upgraded.begin();
+    CHECK(hostOneWire.commands[READPOWERSUPPLY] == 1);
+    CHECK(hostOneWire.searches == 0);
+    CHECK(EEPROM.read(flagAddress) == 1);
+    hostProbes[1].temperature = 32.0f;
+    CHECK_NEAR(upgraded.read(1), 32.0, 0.0001);
+
+    hostProbes[1].isParasite = false; // externally powered again, found by a new search
+    hostProbes[1].temperature = 18.6f;
+    probes.enumerate();
+    CHECK(EEPROM.read(flagAddress) == 0);
+    hostClearOneWireCounters();
+    CHECK_NEAR(probes.read(1), 18.5, 0.0001);
+    CHECK(hostOneWire.poweredWrites == 0);
+}
+
+int main()
+{
+    hostAddProbe(23.45f, 12);
+    hostAddProbe(18.6f, 9);
+    checkEnumerate();
+    checkTransactions();
+    checkConversionWait();
+    checkFaults();
+    checkParasitePower();
+    return testResult("test_temp_probes");
+}
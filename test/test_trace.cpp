@@ -0,0 +1,325 @@
+// raw acquisition traces: a cycle recorded on the simulated inputs,
+// dumped and loaded back, replays through the unmodified sensor classes
+// to the same values, at full speed as a performance workload; the
+// dump()/load() round trip, overflow, broken dumps and the header and
+// acquisition settings check
+//   build/test_trace [trace.txt]
+// the optional file holds a dump as the node sends it ("Trace#<length>",
+// hex lines, "Trace#end"), e.g. the sink's log of a "trace" command; it
+// is replayed instead of the recorded cycle and its values printed
+#include "ESP_EC.h"
+#include "ESP_NH3N.h"
+#include "ESP_PH.h"
+#include "ESP_Turbidity.h"
+#include "test.h"
+
+#include <fstream>
+#include <sstream>
+
+#define REPLAY_SECONDS 1.0 // of replays for the throughput figure
+
+extern ESP_TempProbes tempProbes;
+extern ESP_Trace trace;
+
+static ESP_Sensor *sensors[SENSOR_COUNT];
+
+struct Cycle
+{
+    float value[SENSOR_COUNT];
+    byte status[SENSOR_COUNT];
+};
+
+static Cycle currentCycle()
+{
+    Cycle cycle;
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        cycle.value[i] = sensors[i]->_value;
+        cycle.status[i] = sensors[i]->_status;
+    }
+    return cycle;
+}
+
+static int noisyInput(uint8_t pin)
+{
+    return 800 + 100 * (pin % 16) + (micros() & 15);
+}
+
+static int16_t noisyAds(float fullScaleMillivolts)
+{
+    return hostAdsQuantize(hostAdsMillivolts + (micros() & 7) * 0.1f, fullScaleMillivolts);
+}
+
+// one measurement cycle of all sensors, as the "trace" command does
+static Cycle recordCycle()
+{
+    trace.startRecording();
+    trace.writeHeader(sensors);
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        sensors[i]->updateVoltAndValue();
+    }
+    trace.stop();
+    CHECK(!trace.isError());
+    return currentCycle();
+}
+
+// as the "replay" command does, false on a header, settings or trace mismatch
+static bool replayCycle()
+{
+    trace.startReplay();
+    bool isReplayed = trace.readHeader(sensors) && trace.readAcquisitionConfig();
+    if (isReplayed)
+    {
+        for (int i = 0; i < SENSOR_COUNT; i++)
+        {
+            sensors[i]->updateVoltAndValue();
+        }
+    }
+    trace.stop();
+    return isReplayed && !trace.isError();
+}
+
+static String dumpTrace()
+{
+    Serial.hostClear();
+    trace.dump(&Serial);
+    return Serial.hostTransmitted();
+}
+
+static bool loadTrace(const String &dump)
+{
+    Serial.hostClear();
+    Serial.hostReceive(dump);
+    return trace.load(&Serial);
+}
+
+static void printCycle(const Cycle &cycle)
+{
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        printf("  %-5s %12.4f  status %d\n", sensors[i]->_sensorName.c_str(), cycle.value[i], cycle.status[i]);
+    }
+}
+
+// replays the loaded trace for REPLAY_SECONDS: cycles and trace bytes per second
+static void measureThroughput(const char *name)
+{
+    unsigned int length = dumpTrace().substring(6).toInt();
+    unsigned long cycles = 0;
+    double start = hostSeconds();
+    double seconds;
+    do
+    {
+        CHECK(replayCycle());
+        cycles++;
+        seconds = hostSeconds() - start;
+    } while (seconds < REPLAY_SECONDS);
+    printf("replay of %s: %.0f cycles/s, %.3f ms per cycle, %.1f MB/s of trace\n", name, cycles / seconds,
+           1000 * seconds / cycles, cycles * length / seconds / 1e6);
+}
+
+static void checkRoundTrip()
+{
+    Cycle recorded = recordCycle();
+    String dump = dumpTrace();
+    printf("recorded cycle, %u dump bytes:\n", dump.length());
+    printCycle(recorded);
+    CHECK(dump.startsWith("Trace#"));
+    CHECK(dump.endsWith("Trace#end\r\n"));
+
+    CHECK(loadTrace(dump));
+    CHECK(dumpTrace() == dump);
+    // the sensors keep their last values: turbidity's out-of-range check
+    // looks at the previous one, as it does on the node
+    CHECK(replayCycle());
+    Cycle replayed = currentCycle();
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        CHECK(replayed.status[i] == recorded.status[i]);
+        CHECK((replayed.value[i] == recorded.value[i]) || (isnan(replayed.value[i]) && isnan(recorded.value[i])));
+    }
+    measureThroughput("the recorded cycle");
+}
+
+// the calibrations and enables come from the trace, not from the node
+static void checkHeader()
+{
+    float calibVolt = *sensors[2]->_calibParamArray[0].calibVolt;
+    *sensors[2]->_calibParamArray[0].calibVolt = calibVolt + 100;
+    sensors[3]->_enableSensor = false;
+    recordCycle();
+    String dump = dumpTrace();
+    *sensors[2]->_calibParamArray[0].calibVolt = calibVolt;
+    sensors[3]->_enableSensor = true;
+
+    CHECK(loadTrace(dump));
+    CHECK(replayCycle());
+    CHECK(*sensors[2]->_calibParamArray[0].calibVolt == calibVolt + 100);
+    CHECK(!sensors[3]->_enableSensor);
+    CHECK(sensors[3]->_status == STATUS_DISABLED);
+    *sensors[2]->_calibParamArray[0].calibVolt = calibVolt;
+    sensors[3]->_enableSensor = true;
+}
+
+// byte offset of the acquisition settings in a trace of these sensors
+static unsigned int configOffset()
+{
+    unsigned int offset = 4;
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        offset += 2 + 4 * sensors[i]->_calibParamCount;
+    }
+    return offset;
+}
+
+// changes byte position of a dump to value, as another build would have written it
+static String patchByte(const String &dump, unsigned int position, byte value)
+{
+    int firstLine = dump.indexOf('\n') + 1;
+    int line = position / TRACE_LINE_BYTES;
+    int start = firstLine;
+    for (int i = 0; i < line; i++)
+    {
+        start = dump.indexOf('\n', start) + 1;
+    }
+    char hex[3];
+    snprintf(hex, sizeof(hex), "%02X", value);
+    String patched = dump;
+    patched[start + 2 * (position % TRACE_LINE_BYTES)] = hex[0];
+    patched[start + 2 * (position % TRACE_LINE_BYTES) + 1] = hex[1];
+    return patched;
+}
+
+static void checkSettingsMismatch()
+{
+    recordCycle();
+    String dump = dumpTrace();
+
+    CHECK(loadTrace(patchByte(dump, 2, TRACE_VERSION + 1)));
+    trace.startReplay();
+    CHECK(!trace.readHeader(sensors));
+    trace.stop();
+
+    CHECK(loadTrace(patchByte(dump, 5, sensors[0]->_calibParamCount + 1))); // sensor 0's calibration count
+    trace.startReplay();
+    CHECK(!trace.readHeader(sensors));
+    trace.stop();
+
+    CHECK(loadTrace(patchByte(dump, configOffset(), !AUTO_RANGING)));
+    trace.startReplay();
+    CHECK(trace.readHeader(sensors));
+    CHECK(!trace.readAcquisitionConfig());
+    trace.stop();
+
+    CHECK(loadTrace(patchByte(dump, configOffset() + 5, !USE_FIXED_POINT_SAMPLING)));
+    CHECK(!replayCycle());
+}
+
+// a trace that ends before the sensors read all they did is an error
+static void checkReplayMismatch()
+{
+    recordCycle();
+    String dump = dumpTrace();
+    int end = dump.indexOf("Trace#end");
+    int lastLine = dump.lastIndexOf('\n', end - 2) + 1;
+    unsigned int length = dump.substring(6).toInt() - (end - 2 - lastLine) / 2; // without the last hex line
+    String shortDump = "Trace#" + String(length) + dump.substring(dump.indexOf('\r'), lastLine) + "Trace#end\r\n";
+    CHECK(loadTrace(shortDump));
+    CHECK(!replayCycle());
+}
+
+static void checkOverflow()
+{
+    trace.startRecording();
+    for (unsigned int i = 0; i < TRACE_BUFFER_SIZE / 3; i++)
+    {
+        trace.recordSample(i);
+    }
+    CHECK(!trace.isError());
+    trace.recordSample(1);
+    trace.recordSample(2);
+    CHECK(trace.isError());
+    trace.stop();
+    unsigned int length = dumpTrace().substring(6).toInt();
+    CHECK((length >= TRACE_BUFFER_SIZE / 3 * 3) && (length <= TRACE_BUFFER_SIZE)); // keeps what fits
+}
+
+static void checkBrokenDumps()
+{
+    recordCycle();
+    String dump = dumpTrace();
+    Serial.setTimeout(20);
+
+    CHECK(!loadTrace(dump.substring(0, dump.indexOf("Trace#end")))); // truncated, no end line
+    int secondLine = dump.indexOf('\n') + 1;
+    CHECK(!loadTrace(dump.substring(0, secondLine) + dump.substring(secondLine + 1))); // odd-length line
+    String badHex = dump;
+    badHex[secondLine] = 'G';
+    CHECK(!loadTrace(badHex));
+    CHECK(!loadTrace("Trace#" + String(dump.substring(6).toInt() + 1) + dump.substring(dump.indexOf('\r'))));
+    CHECK(!loadTrace("Trace#" + String(TRACE_BUFFER_SIZE + 1) + "\r\nTrace#end\r\n"));
+    CHECK(!loadTrace("Data#12:00\r\n" + dump));
+    CHECK(loadTrace(dump)); // and a good one still loads after them
+    Serial.setTimeout(1000);
+}
+
+// a dump from a file, e.g. logged by the sink
+static void replayFile(const char *path)
+{
+    std::ifstream file(path);
+    std::stringstream text;
+    text << file.rdbuf();
+    String dump = String(text.str());
+    int start = dump.indexOf("Trace#");
+    if (!file || (start < 0) || !loadTrace(dump.substring(start)))
+    {
+        printf("%s: no loadable trace\n", path);
+        testFailures++;
+        return;
+    }
+    if (!replayCycle())
+    {
+        printf("%s: recorded with other settings, or it does not match the sensor classes\n", path);
+        testFailures++;
+        return;
+    }
+    printf("%s:\n", path);
+    printCycle(currentCycle());
+    measureThroughput(path);
+}
+
+int main(int argc, char **argv)
+{
+    hostAnalogRead = noisyInput;
+    hostAdsConvert = noisyAds;
+    hostAdsMillivolts = 850;
+    hostAddProbe(24.5f, 12);
+    EEPROM.write(TEMP_PROBE_EEPROM_ADDRESS, 0xFF); // no stored probes: search the bus
+    tempProbes.begin();
+    sensors[0] = new ESP_EC;
+    sensors[1] = new ESP_Turbidity;
+    sensors[2] = new ESP_PH;
+    sensors[3] = new ESP_NH3N;
+    for (int i = 0; i < SENSOR_COUNT; i++)
+    {
+        sensors[i]->begin();
+        sensors[i]->_enableSensor = true;
+        sensors[i]->_tempProbe = 0;
+    }
+
+    if (argc > 1)
+    {
+        replayFile(argv[1]);
+    }
+    else
+    {
+        checkRoundTrip();
+        checkHeader();
+        checkSettingsMismatch();
+        checkReplayMismatch();
+        checkOverflow();
+        checkBrokenDumps();
+    }
+    return testResult("test_trace");
+}
@@ -0,0 +1,193 @@
+// ESP_WindowStats against a brute-force window, plus push throughput
+#include "ESP_WindowStats.h"
+#include "test.h"
+
+#include <deque>
+#include <random>
+
+// recomputes everything from the kept readings on every query
+struct BruteWindow
+{
+    std::deque<float> values;
+    unsigned int horizon;
+
+    void push(float value)
+    {
+        if (isnan(value))
+        {
+            return;
+        }
+        values.push_back(value);
+        if (values.size() > horizon)
+        {
+            values.pop_front();
+        }
+    }
+    double mean()
+    {
+        double sum = 0;
+        for (float v : values)
+        {
+            sum += v;
+        }
+        return values.empty() ? NAN : sum / values.size();
+    }
+    double minimum()
+    {
+        double m = INFINITY;
+        for (float v : values)
+        {
+            m = fmin(m, v);
+        }
+        return values.empty() ? NAN : m;
+    }
+    double maximum()
+    {
+        double m = -INFINITY;
+        for (float v : values)
+        {
+            m = fmax(m, v);
+        }
+        return values.empty() ? NAN : m;
+    }
+    double stdDev()
+    {
+        if (values.size() < 2)
+        {
+            return 0;
+        }
+        double m = mean();
+        double sumSq = 0;
+        for (float v : values)
+        {
+            sumSq += (v - m) * (v - m);
+        }
+        return sqrt(sumSq / (values.size() - 1));
+    }
+};
+
+// readings shaped like the sensors: an offset, a slow drift, noise,
+// occasional steps and some disabled (NAN) readings
+static void checkAgainstBruteForce(byte horizon, float offset, float noise, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    std::normal_distribution<float> gaussian(0, noise);
+    std::uniform_real_distribution<float> uniform(0, 1);
+
+    ESP_WindowStats stats;
+    stats.reset(horizon);
+    BruteWindow brute;
+    brute.horizon = horizon;
+
+    float level = offset;
+    for (int i = 0; i < 2000; i++)
+    {
+        if (uniform(random) < 0.01f)
+        {
+            level += offset * 0.5f * (uniform(random) - 0.5f); // step change
+        }
+        level += noise * 0.01f;
+        float value = level + gaussian(random);
+        if (uniform(random) < 0.03f)
+        {
+            value = NAN;
+        }
+        stats.push(value);
+        brute.push(value);
+
+        double tolerance = 1e-4 * fabs(offset) + 1e-3 * noise;
+        CHECK(stats.count() == brute.values.size());
+        CHECK_NEAR(stats.mean(), brute.mean(), tolerance);
+        CHECK(stats.minimum() == (float)brute.minimum() || (isnan(stats.minimum()) && brute.values.empty()));
+        CHECK(stats.maximum() == (float)brute.maximum() || (isnan(stats.maximum()) && brute.values.empty()));
+        CHECK_NEAR(stats.stdDev(), brute.stdDev(), tolerance + 1e-3 * brute.stdDev());
+        if (testFailures > 0)
+        {
+            printf("horizon %d, offset %g, noise %g, reading %d\n", horizon, offset, noise, i);
+            return;
+        }
+    }
+}
+
+static void checkEdgeCases()
+{
+    ESP_WindowStats stats;
+    stats.reset(6);
+    CHECK(stats.count() == 0);
+    CHECK(isnan(stats.mean()));
+    CHECK(isnan(stats.minimum()));
+    CHECK(isnan(stats.maximum()));
+    CHECK(stats.stdDev() == 0);
+
+    stats.push(NAN); // disabled sensor
+    CHECK(stats.count() == 0);
+
+    for (int i = 0; i < 20; i++) // flat window must not give a negative variance
+    {
+        stats.push(7.31f);
+    }
+    CHECK(stats.count() == 6);
+    CHECK(stats.mean() == 7.31f);
+    CHECK(stats.stdDev() == 0);
+
+    stats.reset(0); // clamped to 1
+    stats.push(1);
+    stats.push(2);
+    CHECK(stats.count() == 1);
+    CHECK(stats.mean() == 2);
+
+    stats.reset(200); // clamped to STATS_WINDOW_CAPACITY
+    for (int i = 0; i < 100; i++)
+    {
+        stats.push(i);
+    }
+    CHECK(stats.count() == STATS_WINDOW_CAPACITY);
+    CHECK(stats.minimum() == 100 - STATS_WINDOW_CAPACITY);
+}
+
+// pushes per second for a horizon; the cost must not grow with it
+static double measureThroughput(byte horizon)
+{
+    const int pushes = 5000000;
+    ESP_WindowStats stats;
+    stats.reset(horizon);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> uniform(0, 1000);
+    float values[1024];
+    for (int i = 0; i < 1024; i++)
+    {
+        values[i] = uniform(random);
+    }
+    double start = hostSeconds();
+    for (int i = 0; i < pushes; i++)
+    {
+        stats.push(values[i & 1023]);
+    }
+    double elapsed = hostSeconds() - start;
+    volatile float sink = stats.mean() + stats.minimum() + stats.maximum() + stats.stdDev();
+    (void)sink;
+    return elapsed / pushes * 1e9;
+}
+
+int main()
+{
+    checkEdgeCases();
+    unsigned int seed = 1;
+    for (byte horizon = 1; horizon <= STATS_WINDOW_CAPACITY; horizon++)
+    {
+        checkAgainstBruteForce(horizon, 7.0f, 0.05f, seed++);    // pH
+        checkAgainstBruteForce(horizon, 250.0f, 30.0f, seed++);  // turbidity
+        checkAgainstBruteForce(horizon, 0.8f, 0.002f, seed++);   // EC, small spread
+        checkAgainstBruteForce(horizon, 1500.0f, 0.5f, seed++);  // large offset, small spread
+    }
+
+    double shortCost = measureThroughput(STATS_SHORT_HORIZON);
+    double longCost = measureThroughput(STATS_LONG_HORIZON);
+    printf("push: %.1f ns at horizon %d, %.1f ns at horizon %d (host)\n",
+           shortCost, STATS_SHORT_HORIZON, longCost, STATS_LONG_HORIZON);
+    // O(1) amortized: the periodic re-sum is one pass per full window,
+    // so a 4x longer window must not make a push anywhere near 4x slower
+    CHECK(longCost < shortCost * 2.5);
+
+    return testResult("test_window_stats");
+}